@@ -5,10 +5,17 @@
 #include "../build/_deps/sfml-src/include/SFML/Window.hpp"
 
 #include "entity.h"
+#include "../../common/soaStorage.h"
+#include "../../common/packing.h"
 #include <unordered_map>
 #include <any>
 #include <typeindex>
 #include <tuple>
+#include <type_traits>
+#include <vector>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
 
 
 //Velocity component for direction of travel
@@ -40,20 +47,32 @@ struct positionComponent
     positionComponent(const positionComponent & other) = default;
     ~positionComponent() = default;
 };
+//Position at the start of the last physics tick, used to interpolate rendering
+struct previousPositionComponent
+{
+    float px;
+    float py;
+    previousPositionComponent(): px(0), py(0) {}
+    previousPositionComponent(float X, float Y): px(X), py(Y) {}
+    previousPositionComponent(const previousPositionComponent & other) = default;
+    ~previousPositionComponent() = default;
+};
 //Contains colors for all simple objects without textures
+//stored as RGBA8, see common/packing.h
 struct colorComponent
 {
-    int r,g,b;
-    colorComponent(): r(0), g(0), b(0) {}
-    colorComponent(int R, int G, int B): r(R), g(G), b(B) {}
+    std::uint8_t r,g,b,a;
+    colorComponent(): r(0), g(0), b(0), a(255) {}
+    colorComponent(int R, int G, int B, int A = 255): r(packChannel(R)), g(packChannel(G)), b(packChannel(B)), a(packChannel(A)) {}
     colorComponent(const colorComponent& other) = default;
     ~colorComponent() = default;
 };
+//stored as RGBA8 like colorComponent
 struct outlineComponent
 {
-    int r,g,b;
-    outlineComponent(int R,int G,int B) : r(R), g(G), b(B) {}
-    outlineComponent() : r(0), b(0), g(0) {} //defaults to black
+    std::uint8_t r,g,b,a;
+    outlineComponent(int R,int G,int B,int A = 255) : r(packChannel(R)), g(packChannel(G)), b(packChannel(B)), a(packChannel(A)) {}
+    outlineComponent() : r(0), g(0), b(0), a(255) {} //defaults to black
     ~outlineComponent() = default;
 };
 //Size component for rectangular objects
@@ -91,26 +110,92 @@ struct textureComponent
     ~textureComponent() = default;
 };
 //Hitbox for collission elements - this will always be rectangular
+//extents are 16 bit, see common/packing.h
 struct hitboxComponent
 {
-    int x,y;
+    std::int16_t x,y;
 
     bool bounce;
 
     char type; // 'l' for leftgoal, 'r'for right goal, 'b' for ball, 'p' for paddle, 'w' for wall,
 
     hitboxComponent() : x(0), y(0), bounce(0), type('\0'){}
-    hitboxComponent(const int X, const int Y, const bool b, const char t) : x(X), y(Y), bounce(b), type(t){}
+    hitboxComponent(const int X, const int Y, const bool b, const char t) : x(packExtent(X)), y(packExtent(Y)), bounce(b), type(t){}
     hitboxComponent(const hitboxComponent & other) = default;
     ~hitboxComponent() = default;
 };
 
+//position, velocity, acceleration and hitbox are read every tick by movement and collision,
+//they are kept as structure of arrays with one aligned array per field, see common/soaStorage.h
+//each ref struct has a reference member per field, in the order of the layout's fields
+struct velocityRef
+{
+    float & vx;
+    float & vy;
+};
+
+template <>
+struct soaLayout<velocityComponent>
+{
+    static constexpr bool enabled = true;
+    using ref = velocityRef;
+    static constexpr auto fields = std::make_tuple(&velocityComponent::vx, &velocityComponent::vy);
+};
+
+struct accelerationRef
+{
+    float & ax;
+    float & ay;
+};
+
+template <>
+struct soaLayout<accelerationComponent>
+{
+    static constexpr bool enabled = true;
+    using ref = accelerationRef;
+    static constexpr auto fields = std::make_tuple(&accelerationComponent::ax, &accelerationComponent::ay);
+};
+
+struct positionRef
+{
+    float & px;
+    float & py;
+};
+
+template <>
+struct soaLayout<positionComponent>
+{
+    static constexpr bool enabled = true;
+    using ref = positionRef;
+    static constexpr auto fields = std::make_tuple(&positionComponent::px, &positionComponent::py);
+};
+
+struct hitboxRef
+{
+    std::int16_t & x;
+    std::int16_t & y;
+    bool & bounce;
+    char & type;
+};
+
+template <>
+struct soaLayout<hitboxComponent>
+{
+    static constexpr bool enabled = true;
+    using ref = hitboxRef;
+    static constexpr auto fields = std::make_tuple(&hitboxComponent::x, &hitboxComponent::y,
+                                                   &hitboxComponent::bounce, &hitboxComponent::type);
+};
+
+
 
 
 // Component list for compile-time iteration
 using ComponentList = std::tuple<
     velocityComponent,
+    accelerationComponent,
     positionComponent,
+    previousPositionComponent,
     colorComponent,
     rectangleSizeComponent,
     circleSizeComponent,
@@ -120,6 +205,28 @@ using ComponentList = std::tuple<
 >;
 
 
+//one bit per type in ComponentList, an entity's signature has the bits of every
+//component it currently has
+using componentMask = std::uint64_t;
+static_assert(std::tuple_size_v<ComponentList> <= 64, "componentMask has one bit per component type");
+
+//position of T in ComponentList, which is also its bit in a componentMask
+template <typename T, std::size_t I = 0>
+constexpr std::size_t componentIndex()
+{
+    static_assert(I < std::tuple_size_v<ComponentList>, "type is not in ComponentList");
+    if constexpr (std::is_same_v<T, std::tuple_element_t<I, ComponentList>>) return I;
+    else return componentIndex<T, I + 1>();
+}
+
+//mask with the bit of every listed type set
+template <typename... Ts>
+constexpr componentMask componentMaskOf()
+{
+    return (componentMask(0) | ... | (componentMask(1) << componentIndex<Ts>()));
+}
+
+
 //class to handle all the components of the scene
 //methods to generate component map and handle components
 class componentManager {
@@ -129,22 +236,75 @@ class componentManager {
         void addComponent(const entity& e, const T& component) const
         {
             auto& map = getMap<T>();
-            map[e] = component;
+            map.insert_or_assign(e, component);
+            if (e.isValid()) signatureOf(e) |= componentMaskOf<T>();
+        }
+
+        // Add the same component to count entities with consecutive ids starting at first
+        // Reserves the storage and the signatures once instead of growing them per entity
+        template <typename T>
+        void addComponentRange(const entity& first, std::size_t count, const T& component) const
+        {
+            if (!first.isValid() || count == 0) return;
+            auto& map = getMap<T>();
+            std::uint32_t id = first.entity_id;
+            if constexpr (soaLayout<T>::enabled) {
+                map.fill(id, count, component);
+            } else {
+                map.reserve(map.size() + count);
+                for (std::size_t i = 0; i < count; i++) map.insert_or_assign(entity(id + i), component);
+            }
+
+            auto& sigs = getSignatures();
+            if (id + count > sigs.size()) sigs.resize(id + count, 0);
+            for (std::size_t i = 0; i < count; i++) sigs[id + i] |= componentMaskOf<T>();
+        }
+
+        // Add components[i] to ids[i] for n entities, like a snapshot load does
+        // The storage and the signatures grow once, structure of arrays types write each field
+        // array in its own pass instead of every field of one entity at a time
+        template <typename T>
+        void addComponents(const entity* ids, const T* components, std::size_t n) const
+        {
+            if (n == 0) return;
+            auto& map = getMap<T>();
+            if constexpr (soaLayout<T>::enabled) {
+                map.assign(ids, components, n);
+            } else {
+                map.reserve(map.size() + n);
+                for (std::size_t i = 0; i < n; i++) map.insert_or_assign(ids[i], components[i]);
+            }
+
+            std::size_t end = 0;
+            for (std::size_t i = 0; i < n; i++) {
+                if (ids[i].isValid()) end = std::max(end, static_cast<std::size_t>(ids[i].entity_id) + 1);
+            }
+            auto& sigs = getSignatures();
+            if (end > sigs.size()) sigs.resize(end, 0);
+            for (std::size_t i = 0; i < n; i++) {
+                if (ids[i].isValid()) sigs[ids[i].entity_id] |= componentMaskOf<T>();
+            }
         }
     
         // Get a pointer to the component of type T for entity e
+        // structure of arrays types return an soaPtr that is used the same way
         template <typename T>
-        T* getComponent(const entity& e) const
+        componentPtr<T> getComponent(const entity& e) const
         {
-            if (!e.isValid()) return nullptr;
+            // The signature answers misses without hashing
+            if (!hasComponent<T>(e)) return nullptr;
             auto& map = getMap<T>();
-            auto it = map.find(e);
-    
-            // If found, return a pointer to the component
-            if (it != map.end()) {
-                return &it->second;
+            if constexpr (soaLayout<T>::enabled) {
+                return map.get(e);
             } else {
-                return nullptr;
+                auto it = map.find(e);
+
+                // If found, return a pointer to the component
+                if (it != map.end()) {
+                    return &it->second;
+                } else {
+                    return nullptr;
+                }
             }
         }
     
@@ -152,18 +312,32 @@ class componentManager {
         template <typename T>
         bool hasComponent(const entity& e) const
         {
-            if (!e.isValid()) return false;
-            auto& map = getMap<T>();
-            return map.find(e) != map.end();
+            return (getSignature(e) & componentMaskOf<T>()) != 0;
+        }
+
+        // Check if an entity has every one of the listed component types
+        template <typename... Ts>
+        bool hasComponents(const entity& e) const
+        {
+            constexpr componentMask mask = componentMaskOf<Ts...>();
+            return (getSignature(e) & mask) == mask;
+        }
+
+        // Bits of every component type entity e has, 0 for unknown and invalid entities
+        componentMask getSignature(const entity& e) const
+        {
+            auto& sigs = getSignatures();
+            return e.entity_id < sigs.size() ? sigs[e.entity_id] : 0;
         }
     
         // Remove a component of type T from entity e
         template <typename T>
         void removeComponent(const entity& e) const
         {
-            if (!e.isValid()) return;
+            if (!hasComponent<T>(e)) return;
             auto& map = getMap<T>();
             map.erase(e);
+            signatureOf(e) &= ~componentMaskOf<T>();
         }
 
         //  Clear all components of a type T
@@ -173,31 +347,98 @@ class componentManager {
             auto & map = getMap<T>();
             map.clear();
 
+            for (auto & sig : getSignatures()) sig &= ~componentMaskOf<T>();
+            for (auto & hidden : getHiddenMasks()) hidden &= ~componentMaskOf<T>();
             return;
         }
 
+        //  Clear every component of every entity
+        void clearAllComponents() const
+        {
+            std::apply([&](auto... type) {
+                (..., getMap<decltype(type)>().clear());
+            }, ComponentList{});
+            getSignatures().clear();
+            getHiddenMasks().clear();
+        }
+
         //  Clear all components for an entity
         void clearEntityComponents(const entity & e) const
         {
-            if (!e.isValid()) return;
-
-            //apply the lamda to all types in the component list which
-            //will then call all of the remove component functions for each type
+            auto& hiddenMasks = getHiddenMasks();
+            componentMask hidden = e.entity_id < hiddenMasks.size() ? hiddenMasks[e.entity_id] : 0;
+            componentMask sig = getSignature(e) | hidden;
+            if (sig == 0) return;
+            //apply the lamda to all types in the component list, only the maps of
+            //types in the entity's signature or hidden by deactivateEntity are touched
             std::apply([&](auto... type) {
-                (..., removeComponent<decltype(type)>(e));
+                (..., (sig & componentMaskOf<decltype(type)>() ? (void)getMap<decltype(type)>().erase(e) : (void)0));
             }, ComponentList{});
 
+            signatureOf(e) = 0;
+            if (hidden) hiddenMasks[e.entity_id] = 0;
             return;
         }
 
-        // Storage for components of type T
+        //  Hide all components of an entity but keep their storage slots
+        //  Map entries stay where they are, so adding the same types again later assigns into
+        //  them instead of allocating nodes, see common/entityPool.h
+        void deactivateEntity(const entity & e) const
+        {
+            componentMask sig = getSignature(e);
+            if (sig == 0) return;
+            //structure of arrays slots are kept by erase anyway, it only drops the live flag
+            //the map types are recorded in the hidden mask so clearEntityComponents can still
+            //free their entries
+            componentMask hidden = 0;
+            std::apply([&](auto... type) {
+                (..., ([&] {
+                    using T = decltype(type);
+                    if (!(sig & componentMaskOf<T>())) return;
+                    if constexpr (soaLayout<T>::enabled) getMap<T>().erase(e);
+                    else hidden |= componentMaskOf<T>();
+                }()));
+            }, ComponentList{});
+
+            auto& hiddenMasks = getHiddenMasks();
+            if (e.entity_id >= hiddenMasks.size()) hiddenMasks.resize(static_cast<std::size_t>(e.entity_id) + 1, 0);
+            hiddenMasks[e.entity_id] |= hidden;
+            signatureOf(e) = 0;
+        }
+
+        // Storage for components of type T, an unordered_map or an soaStorage
         // Static map: shared across all instances and calls per component type
+        // Add and remove through the manager, writes to the map skip the signatures
         template <typename T>
-        std::unordered_map<entity, T>& getMap() const
+        componentStorage<T>& getMap() const
         {
-            static std::unordered_map<entity, T> map;
+            static componentStorage<T> map;
             return map;
         }
+
+    private:
+        // Signatures indexed by entity id, static like the maps
+        std::vector<componentMask>& getSignatures() const
+        {
+            static std::vector<componentMask> signatures;
+            return signatures;
+        }
+
+        // Map types of entities hidden by deactivateEntity whose entries are still stored,
+        // indexed by entity id like the signatures
+        std::vector<componentMask>& getHiddenMasks() const
+        {
+            static std::vector<componentMask> hidden;
+            return hidden;
+        }
+
+        // Signature of a valid entity, grows the table to its id
+        componentMask& signatureOf(const entity& e) const
+        {
+            auto& sigs = getSignatures();
+            if (e.entity_id >= sigs.size()) sigs.resize(static_cast<std::size_t>(e.entity_id) + 1, 0);
+            return sigs[e.entity_id];
+        }
     };
 
 
@@ -13,8 +13,12 @@ constexpr float paddleAcceleration(3.0f);
 constexpr float startingBallSpeed(70.0f);
 constexpr float ballAcceleration(5.0f);
 
+//height of the strip at the top of the screen the scoreboard and fps counter are cached in
+constexpr unsigned int HUD_HEIGHT(100);
+
 //score tracking data
 extern int leftScore;
 extern int rightScore;
 
-constexpr float timestep(1.0f/120.0f);
\ No newline at end of file
+//physics tick rate, rendering interpolates between ticks so this can stay low
+constexpr float timestep(1.0f/60.0f);
\ No newline at end of file
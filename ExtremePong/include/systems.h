@@ -4,10 +4,13 @@
 #include "../include/components.h"
 #include "../include/globals.h"
 #include "../include/systems.h"
+#include "../../common/commandBuffer.h"
+#include "../../common/entitySet.h"
 
 #include <cmath>
 #include <vector>
 #include <utility>
+#include <cstdint>
 
 #include "../build/_deps/sfml-src/include/SFML/Graphics.hpp"
 #include "../build/_deps/sfml-src/include/SFML/System.hpp"
@@ -20,8 +23,20 @@ using namespace std;
 class movementSystem
 {
     public:
-    void updatePosition (const entity & e, velocityComponent* v, positionComponent* p, 
-                        componentManager & cm, std::vector<entity> & ents);
+    //entities that leave the screen are recorded into cmds for deletion
+    void updatePosition (const entity & e, componentPtr<velocityComponent> v, componentPtr<positionComponent> p, 
+                        componentManager & cm, commandBuffer & cmds);
+};
+
+//stores the last tick's positions and blends them with the current ones for rendering
+class interpolationSystem
+{
+    public:
+    //saves the current position as the previous one before a physics tick runs
+    void storePrevious(const entity & e, componentPtr<positionComponent> p, componentManager & cm);
+
+    //returns the position alpha of the way between the previous and current tick
+    positionComponent interpolate(const entity & e, componentPtr<positionComponent> p, componentManager & cm, float alpha);
 };
 
 //renders rectangles on screen
@@ -50,13 +65,13 @@ class circRenderSystem
 class collisionSystem
 {
     public:
-    bool checkCollision(const entity e, positionComponent * p1, hitboxComponent * h1, 
-                        velocityComponent * v1, componentManager & cm);
+    bool checkCollision(const entity e, componentPtr<positionComponent> p1, componentPtr<hitboxComponent> h1, 
+                        componentPtr<velocityComponent> v1, componentManager & cm);
 
 
     //returns the face of the colission (ie. t, b, l, r) returns \0 for no collision
-    char getCollisionFace(positionComponent * p1, positionComponent * p2,
-                          hitboxComponent * h1, hitboxComponent * h2);
+    char getCollisionFace(componentPtr<positionComponent> p1, componentPtr<positionComponent> p2,
+                          componentPtr<hitboxComponent> h1, componentPtr<hitboxComponent> h2);
 
 
     void resetBall (const entity & e, componentManager & cm, bool side);
@@ -64,6 +79,38 @@ class collisionSystem
 };
 
 
+//draws the scoreboard and fps counter
+//text is only rebuilt when a value it shows changes and all of it is cached in one
+//texture, so an unchanged HUD costs a single sprite draw per frame
+class hudSystem
+{
+    private:
+        sf::Text scoreText;
+        sf::Text fpsText;
+
+        sf::RenderTexture target;
+        sf::Sprite sprite;
+
+        //values currently shown, used to skip rebuilding unchanged text
+        int shownLeft = -1;
+        int shownRight = -1;
+        long shownFps = -1;
+        size_t shownCount = SIZE_MAX;
+
+        bool dirty = true;
+
+    public:
+        hudSystem(const sf::Font & font);
+
+        void setScore(int left, int right);
+
+        void setStats(float fps, size_t entityCount);
+
+        //redraws the cached texture if anything changed, then draws it
+        void render(sf::RenderWindow & w);
+};
+
+
 //handles all systems in a scene
 //will auto create all systems
 class systemManager
@@ -73,36 +120,53 @@ class systemManager
         circRenderSystem cir;
         movementSystem mov;
         collisionSystem col;
+        interpolationSystem lerp;
+
+        //structural changes recorded while iterating, played back after the tick
+        std::vector<commandBuffer> commands = std::vector<commandBuffer>(1);
     public:
 
         //runs all dynamic systems
-        void runPhysicsSystems(std::vector <entity> & ent, componentManager & cm){
+        void runPhysicsSystems(entitySet & ent, componentManager & cm){
+            //snapshot positions so rendering can blend between ticks
+            for (const auto & e : ent){
+                if (!cm.hasComponent<velocityComponent>(e)) continue;
+                lerp.storePrevious(e, cm.getComponent<positionComponent>(e), cm);
+            }
+
             for (const auto & e : ent){
-                auto *v = cm.getComponent<velocityComponent>(e);
-                auto *h = cm.getComponent<hitboxComponent>(e);
-                auto *p = cm.getComponent<positionComponent>(e);
+                auto v = cm.getComponent<velocityComponent>(e);
+                auto h = cm.getComponent<hitboxComponent>(e);
+                auto p = cm.getComponent<positionComponent>(e);
             
                 //check entity collisions
                 //cout << "Checking collisions...\n";    
                 col.checkCollision(e, p, h, v, cm);
 
                 //update positionns
-                mov.updatePosition(e, v, p, cm, ent);
+                mov.updatePosition(e, v, p, cm, commands[0]);
 
                 //update paddle speed
                 //paddleSpeed += paddleAcceleration * timestep;
             }
+
+            //entities that went OOB are removed now that nothing iterates ent
+            playbackCommands(commands, cm, ent);
         }
 
-        void render(std::vector <entity> & ents, componentManager & cm, sf::RenderWindow & w){
+        //alpha is how far the frame is between the last two physics ticks (0 to 1)
+        void render(entitySet & ents, componentManager & cm, sf::RenderWindow & w, float alpha = 1.0f){
             for (auto & i : ents){  
                 auto *s = cm.getComponent<rectangleSizeComponent>(i);
-                auto *p = cm.getComponent<positionComponent>(i);
+                auto pos = cm.getComponent<positionComponent>(i);
                 auto *c = cm.getComponent<colorComponent>(i);
                 auto *t = cm.getComponent<textureComponent>(i);
                 auto *o = cm.getComponent<outlineComponent>(i);
 
-                if (!p) continue;
+                if (!pos) continue;
+
+                positionComponent drawPos = lerp.interpolate(i, pos, cm, alpha);
+                auto *p = &drawPos;
 
                 if (t){
                     sf::Sprite sp(t->texture);
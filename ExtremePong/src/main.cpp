@@ -26,7 +26,7 @@ using namespace std;
 int main()
 {
     //create entity vectors
-    vector<entity> entityVec;
+    entitySet entityVec;
     componentManager cm;
     
     //create system manager
@@ -112,20 +112,8 @@ int main()
         return 1;
     }
 
-    // FPS Text Setup
-    sf::Text fpsText(font);
-    fpsText.setCharacterSize(16);
-    fpsText.setFillColor(sf::Color::White);
-    fpsText.setPosition({10.f, 10.f});
-
-    //init entity count
-    int entCount = entityVec.size();
-
-    // Scoreboard Text Setup
-    sf::Text scoreText(font);
-    scoreText.setCharacterSize(48);  // Large font
-    scoreText.setFillColor(sf::Color::White);
-    scoreText.setStyle(sf::Text::Bold);
+    // Scoreboard and FPS display
+    hudSystem hud(font);
 
     // --- Create SFML window at 1080p HS resolution
     sf::RenderWindow window(sf::VideoMode({WIDTH, HEIGHT}), "2d_game_sfml");
@@ -147,7 +135,7 @@ int main()
     while (window.isOpen())
     {
         //flags for logging pressed keys
-        bool w,s,U,D;   
+        bool w = false, s = false, U = false, D = false;
 
         //Poll events
         while (const std::optional event = window.pollEvent())
@@ -170,10 +158,10 @@ int main()
         }
 
         //Paddle Components
-        auto * pl = cm.getComponent<positionComponent>(leftPaddle);
-        auto * vl = cm.getComponent<velocityComponent>(leftPaddle);
-        auto * pr = cm.getComponent<positionComponent>(rightPaddle);
-        auto * vr = cm.getComponent<velocityComponent>(rightPaddle);
+        auto pl = cm.getComponent<positionComponent>(leftPaddle);
+        auto vl = cm.getComponent<velocityComponent>(leftPaddle);
+        auto pr = cm.getComponent<positionComponent>(rightPaddle);
+        auto vr = cm.getComponent<velocityComponent>(rightPaddle);
 
         //Input handling for left paddle
         if ((w && s) || (!w && !s)) vl->vy = 0;
@@ -223,7 +211,9 @@ int main()
 
         window.clear();
         window.draw(field);
-        sm.render(entityVec, cm, window); // Rendering
+        //blend between the last two physics ticks by the leftover time
+        float alpha = static_cast<float>(accumulator / timestep);
+        sm.render(entityVec, cm, window, alpha); // Rendering
 
 
         //render framerate
@@ -231,31 +221,16 @@ int main()
         fpsTimer += fpsClock.restart().asSeconds();
 
         if (fpsTimer >= 0.5f) { // update every half second
-            entCount = entityVec.size();
             currentFPS = frameCount / fpsTimer;
-        
-            ostringstream ss;
-            ss.precision(0);
-            ss << std::fixed << "FPS: " << currentFPS << endl;
-            ss << std::fixed << "Entity Count: " << entCount;
-            fpsText.setString(ss.str());
+            hud.setStats(currentFPS, entityVec.size());
         
             frameCount = 0;
             fpsTimer = 0.0f;
         }        
 
         // Update and render the scoreboard
-        // Update scoreboard display
-        std::ostringstream scoreStream;
-        scoreStream << leftScore << "   |   " << rightScore;
-        scoreText.setString(scoreStream.str());
-
-        // Center the scoreboard horizontally
-        sf::FloatRect textBounds = scoreText.getLocalBounds();
-        scoreText.setPosition({(WIDTH / 2) - (textBounds.size.x/2), 30});  // Top center of the screen
-
-        window.draw(scoreText);
-        window.draw(fpsText);
+        hud.setScore(leftScore, rightScore);
+        hud.render(window);
 
         window.display();
     }
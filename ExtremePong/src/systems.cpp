@@ -1,8 +1,8 @@
 #include "../include/systems.h"
 
 
-void movementSystem::updatePosition (const entity & e, velocityComponent* v, positionComponent* p, 
-    componentManager & cm, std::vector<entity> & ents)
+void movementSystem::updatePosition (const entity & e, componentPtr<velocityComponent> v, componentPtr<positionComponent> p, 
+    componentManager & cm, commandBuffer & cmds)
     {
     //cout << "Updating position of " << e.entity_id << endl;
     if (!v || !p) return;
@@ -26,15 +26,32 @@ void movementSystem::updatePosition (const entity & e, velocityComponent* v, pos
     //OOB checking for objects travelling off into oblivion
     if ((p->px > WIDTH*1.2 || p->px < 0-WIDTH*.2) || 
         (p->py > HEIGHT*1.2 || p->py < 0-HEIGHT*.2)) {
-        //clear all the components to prepare for deletion
-        cm.clearEntityComponents(e);
-
-        //delete the entity from the vector of entities
-        std::erase(ents, e);
+        //deleted at the end of the tick, ents is still being iterated
+        cmds.destroy(e);
     }
 }
 
 
+void interpolationSystem::storePrevious(const entity & e, componentPtr<positionComponent> p, componentManager & cm)
+{
+    if (!p) return;
+    cm.addComponent<previousPositionComponent>(e, previousPositionComponent(p->px, p->py));
+}
+
+
+positionComponent interpolationSystem::interpolate(const entity & e, componentPtr<positionComponent> p,
+    componentManager & cm, float alpha)
+{
+    auto *prev = cm.getComponent<previousPositionComponent>(e);
+
+    //entities that never moved are drawn where they are
+    if (!prev) return positionComponent(p->px, p->py);
+
+    return positionComponent(prev->px + (p->px - prev->px) * alpha,
+                             prev->py + (p->py - prev->py) * alpha);
+}
+
+
 void rectRenderSystem::renderRect(rectangleSizeComponent * rec, positionComponent * p,
     colorComponent * c, outlineComponent * o, sf::RenderWindow & window)
 {
@@ -75,8 +92,8 @@ void circRenderSystem::renderCirc(circleSizeComponent * r, positionComponent * p
 }
 
 
-bool collisionSystem::checkCollision(const entity e, positionComponent * p1, hitboxComponent * h1, 
-    velocityComponent * v1, componentManager & cm){
+bool collisionSystem::checkCollision(const entity e, componentPtr<positionComponent> p1, componentPtr<hitboxComponent> h1, 
+    componentPtr<velocityComponent> v1, componentManager & cm){
     if (h1->type == 'p' || h1->type == 'w') return false;
     //nullptr checks
     if (!p1 || !h1) return false;
@@ -87,31 +104,31 @@ bool collisionSystem::checkCollision(const entity e, positionComponent * p1, hit
 
     //iterate through all ents with a hitbox
     //cout << "Starting Loop...\n";
-    for (auto & c : cm.getMap<hitboxComponent>()){
+    for (const auto & c : cm.getMap<hitboxComponent>()){
         
         if (c.first.entity_id != e.entity_id){
 
             //cout << "Getting p2...\n";
-            auto * p2 = cm.getComponent<positionComponent>(c.first);
-            hitboxComponent & h2 = c.second;
+            auto p2 = cm.getComponent<positionComponent>(c.first);
+            auto h2 = cm.getComponent<hitboxComponent>(c.first);
 
             //nullptr check
             if (!p2) continue;
 
             //cout << "Getting Col Face...\n";
             //check object collision
-            char face = getCollisionFace(p1,p2,h1,&h2);
+            char face = getCollisionFace(p1,p2,h1,h2);
 
             //cout << "Face Got...\n";
             if (!v1) continue;
             if (face != '\0'){
-                if (h2.type == 'l'){
+                if (h2->type == 'l'){
                     resetBall(e, cm, true);
                     //cout << "LEFT GOAL\n";
                     leftScore++;
                     return true;
                 }
-                if (h2.type == 'r'){
+                if (h2->type == 'r'){
                     resetBall(e, cm, false);
                     //cout << "RIGHT GOAL\n";
                     rightScore++;
@@ -154,8 +171,8 @@ bool collisionSystem::checkCollision(const entity e, positionComponent * p1, hit
 
 
 //returns the face of the colission (ie. t, b, l, r) returns \0 for no collision
-char collisionSystem::getCollisionFace(positionComponent * p1, positionComponent * p2,
-      hitboxComponent * h1, hitboxComponent * h2){
+char collisionSystem::getCollisionFace(componentPtr<positionComponent> p1, componentPtr<positionComponent> p2,
+      componentPtr<hitboxComponent> h1, componentPtr<hitboxComponent> h2){
     //ensure there is a colision before proceeding
     float me = 0.1f;
 
@@ -199,7 +216,69 @@ void collisionSystem::resetBall (const entity & e, componentManager & cm, bool s
     }
     cm.addComponent<velocityComponent>(e, velocityComponent(speed, speed));
     cm.addComponent<positionComponent>(e, positionComponent(WIDTH/2, HEIGHT/2));
+    //snap the previous position too so the ball doesnt smear across the field
+    cm.addComponent<previousPositionComponent>(e, previousPositionComponent(WIDTH/2, HEIGHT/2));
 
     paddleSpeed = startingPaddleSpeed;
     return;
+}
+
+
+hudSystem::hudSystem(const sf::Font & font)
+    : scoreText(font), fpsText(font), target({WIDTH, HUD_HEIGHT}), sprite(target.getTexture())
+{
+    // FPS Text Setup
+    fpsText.setCharacterSize(16);
+    fpsText.setFillColor(sf::Color::White);
+    fpsText.setPosition({10.f, 10.f});
+
+    // Scoreboard Text Setup
+    scoreText.setCharacterSize(48);  // Large font
+    scoreText.setFillColor(sf::Color::White);
+    scoreText.setStyle(sf::Text::Bold);
+
+    sprite.setPosition({0, 0});
+}
+
+
+void hudSystem::setScore(int left, int right){
+    if (left == shownLeft && right == shownRight) return;
+
+    shownLeft = left;
+    shownRight = right;
+
+    scoreText.setString(std::to_string(left) + "   |   " + std::to_string(right));
+
+    // Center the scoreboard horizontally
+    sf::FloatRect textBounds = scoreText.getLocalBounds();
+    scoreText.setPosition({(WIDTH / 2) - (textBounds.size.x/2), 30});  // Top center of the screen
+
+    dirty = true;
+}
+
+
+void hudSystem::setStats(float fps, size_t entityCount){
+    //compare at the precision that is displayed
+    long rounded = std::lround(fps);
+    if (rounded == shownFps && entityCount == shownCount) return;
+
+    shownFps = rounded;
+    shownCount = entityCount;
+
+    fpsText.setString("FPS: " + std::to_string(rounded) + "\nEntity Count: " + std::to_string(entityCount));
+
+    dirty = true;
+}
+
+
+void hudSystem::render(sf::RenderWindow & w){
+    if (dirty){
+        target.clear(sf::Color::Transparent);
+        target.draw(scoreText);
+        target.draw(fpsText);
+        target.display();
+        dirty = false;
+    }
+
+    w.draw(sprite);
 }
\ No newline at end of file
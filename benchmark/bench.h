@@ -0,0 +1,355 @@
+// Shared pieces of the scalability benchmark
+// Included by benchMain.cpp after the systems header of the variant being measured
+
+#pragma once
+
+#include "../common/allocTracker.h"
+#include "../common/entitySet.h"
+#include "../common/frameStats.h"
+#include "../common/prefab.h"
+#include "../common/scenario.h"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <tuple>
+#include <vector>
+
+//sweep settings, all overridable from the command line
+struct benchConfig
+{
+    std::vector<int> counts{100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000, 100000};
+    std::vector<int> threads{1, 2, 4, 8};
+
+    int warmupTicks = 3;
+    int ticks = 30;
+    std::uint32_t seed = 12345;
+
+    //a point stops early once its timed ticks add up to this
+    double maxPointMs = 5000.0;
+
+    //larger counts are skipped once a tick takes longer than this
+    double maxTickMs = 1000.0;
+
+    //fail the run when a timed tick allocates more than this many times, negative disables
+    //warmup ticks are excluded, so 0 asserts that steady state frames never touch the heap
+    long long maxSteadyAllocs = -1;
+
+    std::string csvPath;
+    std::string jsonPath;
+};
+
+//one measured point of the sweep
+struct benchResult
+{
+    std::string variant;
+    int entities = 0;
+    int threads = 0;
+    int ticks = 0;
+
+    double msMean = 0.0;
+    double msMin = 0.0;
+    double msMax = 0.0;
+
+    //tick time percentiles
+    double msP50 = 0.0;
+    double msP90 = 0.0;
+    double msP99 = 0.0;
+
+    //per tick averages
+    double pairsTested = 0.0;
+    double collisionsFound = 0.0;
+
+    //heap allocations per timed tick, and the most any single tick made
+    double allocsPerTick = 0.0;
+    double allocBytesPerTick = 0.0;
+    std::uint64_t allocsMax = 0;
+
+    std::size_t entitiesLeft = 0;
+};
+
+
+inline std::vector<int> parseList(const std::string & s)
+{
+    std::vector<int> out;
+    std::stringstream ss(s);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        if (!item.empty()) out.push_back(std::atoi(item.c_str()));
+    }
+    return out;
+}
+
+
+inline void printUsage(const char * exe)
+{
+    std::cerr << "usage: " << exe << " [--counts 100,1000,...] [--threads 1,2,4,...] [--ticks N]\n"
+              << "       [--warmup N] [--seed N] [--max-tick-ms MS] [--max-point-ms MS]\n"
+              << "       [--max-steady-allocs N] [--csv file] [--json file]\n"
+              << "       [--config file] [--width N] [--height N] [--broadphase bruteforce|quadtree]\n"
+              << "       [--max-level N] [--max-objects N] [--kernels scalar|sse42|avx2|avx512]\n"
+              << "CSV goes to stdout when neither --csv nor --json is given\n";
+}
+
+
+//returns false if the arguments could not be parsed
+inline bool parseArgs(int argc, char ** argv, benchConfig & cfg)
+{
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (arg == "--help" || arg == "-h") return false;
+        if (!hasValue) {
+            std::cerr << "missing value for " << arg << "\n";
+            return false;
+        }
+
+        std::string value = argv[++i];
+        if (arg == "--counts") cfg.counts = parseList(value);
+        else if (arg == "--threads") cfg.threads = parseList(value);
+        else if (arg == "--ticks") cfg.ticks = std::max(1, std::atoi(value.c_str()));
+        else if (arg == "--warmup") cfg.warmupTicks = std::max(0, std::atoi(value.c_str()));
+        else if (arg == "--seed") cfg.seed = static_cast<std::uint32_t>(std::strtoul(value.c_str(), nullptr, 10));
+        else if (arg == "--max-tick-ms") cfg.maxTickMs = std::atof(value.c_str());
+        else if (arg == "--max-point-ms") cfg.maxPointMs = std::atof(value.c_str());
+        else if (arg == "--max-steady-allocs") cfg.maxSteadyAllocs = std::atoll(value.c_str());
+        else if (arg == "--csv") cfg.csvPath = value;
+        else if (arg == "--json") cfg.jsonPath = value;
+#ifndef FIXED_CONFIG
+        //scenario settings of the demo being measured, e.g. --max-objects or --broadphase
+        else if (arg == "--config") {
+            if (!loadRunConfig(value, config)) return false;
+        }
+        else if (arg.rfind("--", 0) == 0 && applyRunConfig(arg.substr(2), value, config)) {}
+#endif
+        else {
+            std::cerr << "unknown argument " << arg << "\n";
+            return false;
+        }
+    }
+    return true;
+}
+
+
+//removes every component of every type, the component maps are static so they
+//outlive the systemManager of a sweep point
+inline void clearWorld(componentManager & cm)
+{
+    cm.clearAllComponents();
+}
+
+
+//builds the same scene as the demos, walls first then count moving rectangles placed by
+//the configured scenario preset. Overlaps are allowed unlike in the demos, at the high end
+//of the sweep the screen cannot hold that many non overlapping boxes
+inline void spawnScene(componentManager & cm, entitySet & staticEnts,
+                       entitySet & dynamEnts, int count, std::uint32_t seed)
+{
+    int id = 0;
+
+    auto addWall = [&](float x, float y, int w, int h) {
+        entity e(id++);
+        staticEnts.push_back(e);
+        cm.addComponent(e, positionComponent(x, y));
+        cm.addComponent(e, rectangleSizeComponent(w, h));
+        cm.addComponent(e, colorComponent(200, 200, 200));
+        cm.addComponent(e, hitboxComponent(w, h, 1));
+    };
+
+    addWall(0, config.height - 10, config.width, 10);
+    addWall(0, 0, config.width, 10);
+    addWall(0, 0, 10, config.height);
+    addWall(config.width - 10, 0, 10, config.height);
+
+    scenarioParams scene;
+    scene.type = config.scenario;
+    scene.seed = seed;
+    scene.width = config.width;
+    scene.height = config.height;
+    scene.rectangles = count;
+    scene.separate = false;
+
+    std::vector<spawnDesc> spawns;
+    generateScenario(scene, spawns);
+
+    prefab box;
+    box.set(positionComponent())
+       .set(rectangleSizeComponent())
+       .set(velocityComponent())
+       .set(colorComponent(255, 255, 255))
+       .set(hitboxComponent(0, 0, 1));
+
+    entityRange boxes = instantiate(cm, box, spawns.size(), id);
+    dynamEnts.insert(boxes.begin(), boxes.end());
+
+    for (std::size_t i = 0; i < spawns.size(); i++) {
+        const spawnDesc & s = spawns[i];
+        entity e = boxes[i];
+
+        auto p = cm.getComponent<positionComponent>(e);
+        p->px = s.x;
+        p->py = s.y;
+        auto v = cm.getComponent<velocityComponent>(e);
+        v->vx = s.vx;
+        v->vy = s.vy;
+        auto h = cm.getComponent<hitboxComponent>(e);
+        h->x = packExtent(s.w);
+        h->y = packExtent(s.h);
+
+        *cm.getComponent<rectangleSizeComponent>(e) = rectangleSizeComponent(s.w, s.h);
+    }
+}
+
+
+//times ticks of a prepared scene, step() runs one physics tick and returns its stats
+template <typename Step>
+benchResult measure(const benchConfig & cfg, Step step)
+{
+    using clock = std::chrono::steady_clock;
+
+    benchResult r;
+    for (int i = 0; i < cfg.warmupTicks; i++) step();
+
+    hdrHistogram hist;
+    double total = 0.0;
+    double pairs = 0.0;
+    double hits = 0.0;
+    allocSample allocs;
+    r.msMin = 1e300;
+
+    for (int i = 0; i < cfg.ticks; i++) {
+        allocSample allocStart = allocTracker::now();
+        auto start = clock::now();
+        physicsStats s = step();
+        auto elapsed = clock::now() - start;
+        allocSample tickAllocs = allocTracker::now() - allocStart;
+        double ms = std::chrono::duration<double, std::milli>(elapsed).count();
+        hist.record(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+
+        total += ms;
+        pairs += s.pairsTested;
+        hits += s.collisionsFound;
+        r.msMin = std::min(r.msMin, ms);
+        r.msMax = std::max(r.msMax, ms);
+        allocs.count += tickAllocs.count;
+        allocs.bytes += tickAllocs.bytes;
+        r.allocsMax = std::max(r.allocsMax, tickAllocs.count);
+        r.ticks++;
+
+        if (total >= cfg.maxPointMs) break;
+    }
+
+    r.msMean = total / r.ticks;
+    r.msP50 = hist.percentile(50) / 1e6;
+    r.msP90 = hist.percentile(90) / 1e6;
+    r.msP99 = hist.percentile(99) / 1e6;
+    r.pairsTested = pairs / r.ticks;
+    r.collisionsFound = hits / r.ticks;
+    r.allocsPerTick = double(allocs.count) / r.ticks;
+    r.allocBytesPerTick = double(allocs.bytes) / r.ticks;
+    return r;
+}
+
+
+inline void writeCsv(std::ostream & out, const std::vector<benchResult> & results)
+{
+    out << "variant,entities,threads,ticks,ms_mean,ms_min,ms_max,ms_p50,ms_p90,ms_p99,pairs_tested,collisions_found,allocs_per_tick,alloc_bytes_per_tick,allocs_max,entities_left\n";
+    for (const auto & r : results) {
+        out << r.variant << ',' << r.entities << ',' << r.threads << ',' << r.ticks << ','
+            << r.msMean << ',' << r.msMin << ',' << r.msMax << ','
+            << r.msP50 << ',' << r.msP90 << ',' << r.msP99 << ','
+            << r.pairsTested << ',' << r.collisionsFound << ','
+            << r.allocsPerTick << ',' << r.allocBytesPerTick << ',' << r.allocsMax << ','
+            << r.entitiesLeft << '\n';
+    }
+}
+
+
+inline void writeJson(std::ostream & out, const std::vector<benchResult> & results)
+{
+    out << "[\n";
+    for (std::size_t i = 0; i < results.size(); i++) {
+        const auto & r = results[i];
+        out << "  {\"variant\":\"" << r.variant << "\",\"entities\":" << r.entities
+            << ",\"threads\":" << r.threads << ",\"ticks\":" << r.ticks
+            << ",\"ms_mean\":" << r.msMean << ",\"ms_min\":" << r.msMin << ",\"ms_max\":" << r.msMax
+            << ",\"ms_p50\":" << r.msP50 << ",\"ms_p90\":" << r.msP90 << ",\"ms_p99\":" << r.msP99
+            << ",\"pairs_tested\":" << r.pairsTested << ",\"collisions_found\":" << r.collisionsFound
+            << ",\"allocs_per_tick\":" << r.allocsPerTick << ",\"alloc_bytes_per_tick\":" << r.allocBytesPerTick
+            << ",\"allocs_max\":" << r.allocsMax
+            << ",\"entities_left\":" << r.entitiesLeft << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "]\n";
+}
+
+
+//writes the results wherever the config asks, stdout CSV by default
+inline bool writeResults(const benchConfig & cfg, const std::vector<benchResult> & results)
+{
+    if (cfg.csvPath.empty() && cfg.jsonPath.empty()) {
+        writeCsv(std::cout, results);
+        return true;
+    }
+    if (!cfg.csvPath.empty()) {
+        std::ofstream out(cfg.csvPath);
+        if (!out) return false;
+        writeCsv(out, results);
+    }
+    if (!cfg.jsonPath.empty()) {
+        std::ofstream out(cfg.jsonPath);
+        if (!out) return false;
+        writeJson(out, results);
+    }
+    return true;
+}
+
+
+//runs runPoint(count, threads) over the whole sweep
+//once a thread count gets too slow its larger entity counts are skipped
+template <typename RunPoint>
+std::vector<benchResult> runSweep(const benchConfig & cfg, const std::vector<int> & threadCounts,
+                                  RunPoint runPoint)
+{
+    std::vector<benchResult> results;
+
+    for (int t : threadCounts) {
+        for (int n : cfg.counts) {
+            benchResult r = runPoint(n, t);
+            std::cerr << r.variant << " entities=" << n << " threads=" << t
+                      << " ms/tick=" << r.msMean << "\n";
+            results.push_back(r);
+
+            if (r.msMean > cfg.maxTickMs) {
+                std::cerr << r.variant << " threads=" << t << " over " << cfg.maxTickMs
+                          << "ms per tick, skipping larger counts\n";
+                break;
+            }
+        }
+    }
+
+    return results;
+}
+
+
+//false if any point made more steady state allocations than the config allows
+//needs TRACK_ALLOCS, otherwise every tick reads as allocation free
+inline bool checkSteadyAllocs(const benchConfig & cfg, const std::vector<benchResult> & results)
+{
+    if (cfg.maxSteadyAllocs < 0) return true;
+
+    bool ok = true;
+    for (const auto & r : results) {
+        if (r.allocsMax > static_cast<std::uint64_t>(cfg.maxSteadyAllocs)) {
+            std::cerr << r.variant << " entities=" << r.entities << " threads=" << r.threads
+                      << " allocated " << r.allocsMax << " times in one steady state tick (limit "
+                      << cfg.maxSteadyAllocs << ")\n";
+            ok = false;
+        }
+    }
+    return ok;
+}
@@ -0,0 +1,116 @@
+// Headless scalability benchmark for the collision demos
+// Build once per physics path:
+//   -DBENCH_BRUTEFORCE  test/              single threaded, every pair
+//   -DBENCH_THREADED    multiThreadedTest/ threaded, every pair
+//   -DBENCH_QUADTREE    quadTreeCollisions/ threaded, quadtree broadphase
+// Heap allocations are always counted, the benchmark is its own translation unit.
+
+#define TRACK_ALLOCS
+
+#if defined(BENCH_BRUTEFORCE)
+#include "../test/systems.h"
+#define BENCH_VARIANT "bruteforce"
+#elif defined(BENCH_THREADED)
+#include "../multiThreadedTest/systems.h"
+#define BENCH_VARIANT "threaded"
+#elif defined(BENCH_QUADTREE)
+#include "../quadTreeCollisions/systems.h"
+#define BENCH_VARIANT "quadtree"
+#else
+#error "define one of BENCH_BRUTEFORCE, BENCH_THREADED or BENCH_QUADTREE"
+#endif
+
+#include "bench.h"
+
+using namespace std;
+
+
+//spawns a scene of count rectangles and times the variant's physics step on it
+benchResult runPoint(const benchConfig & cfg, int count, int threads)
+{
+    componentManager cm;
+    clearWorld(cm);
+
+    entitySet staticEnts;
+    entitySet dynamEnts;
+    spawnScene(cm, staticEnts, dynamEnts, count, cfg.seed);
+
+    benchResult r;
+
+#if defined(BENCH_BRUTEFORCE)
+    systemManager sm;
+    r = measure(cfg, [&] {
+        sm.runPhysicsSystems(dynamEnts, cm);
+        return sm.stats;
+    });
+    r.entitiesLeft = dynamEnts.size();
+#elif defined(BENCH_THREADED)
+    systemManager sm;
+    sm.setThreadCount(threads);
+    sm.setBuildGeometry(false);
+    vector<renderBuffer> out;
+    r = measure(cfg, [&] {
+        sm.runPhysicsSystems(dynamEnts, cm, out);
+        return sm.stats;
+    });
+    r.entitiesLeft = dynamEnts.size();
+#elif defined(BENCH_QUADTREE)
+    //the quadtree demo keeps the walls in the same set as everything else
+    entitySet ents = staticEnts;
+    ents.insert(dynamEnts.begin(), dynamEnts.end());
+
+    systemManager sm;
+    sm.setThreadCount(threads);
+    sm.setBuildGeometry(false);
+    vector<renderBuffer> out;
+    r = measure(cfg, [&] {
+        sm.runPhysicsSystems(ents, cm, out);
+        return sm.stats;
+    });
+    r.entitiesLeft = ents.size() - staticEnts.size();
+#endif
+
+    r.variant = BENCH_VARIANT;
+    r.entities = count;
+    r.threads = threads;
+
+    clearWorld(cm);
+    return r;
+}
+
+
+int main(int argc, char ** argv)
+{
+    benchConfig cfg;
+    if (!parseArgs(argc, argv, cfg)) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    //results are only comparable between runs on the same kernels
+    cpuLevel kernels = kernelLevel();
+    cerr << "kernels: " << cpuLevelName(kernels) << "\n";
+
+#if defined(BENCH_BRUTEFORCE)
+    //the brute force path has no threads to sweep
+    vector<int> threadCounts{1};
+#else
+    vector<int> threadCounts = cfg.threads;
+#endif
+
+    auto results = runSweep(cfg, threadCounts, [&](int n, int t) {
+        return runPoint(cfg, n, t);
+    });
+
+    //per system percentiles and counters when built with -DPROFILE (and -DPROFILE_COUNTERS)
+    PROFILE_REPORT("bench_frame_stats.csv");
+
+    if (!writeResults(cfg, results)) {
+        cerr << "Failed to write results\n";
+        return 1;
+    }
+
+    if (!checkSteadyAllocs(cfg, results)) return 2;
+
+    return 0;
+}
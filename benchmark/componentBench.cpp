@@ -0,0 +1,337 @@
+// Microbenchmark for componentManager operations
+// Times add/get/has/remove/clearEntityComponents and iteration over getMap<T>() for
+// sequential ids, random ids and a high churn pattern, the churn once more through an
+// entityPool, and spawning rectangles by instantiating a prefab against one add at a time.
+// Reports heap allocations per op and, where the kernel allows it, cache misses per op.
+// Before timing anything it checks entitySet::erase on elements of the set itself and exits
+// with 1 if that goes wrong. No display or SFML needed:
+//   g++ -std=c++20 -O2 -o componentBench componentBench.cpp
+
+#define TRACK_ALLOCS
+
+#include "../test/components.h"
+#include "../common/entityPool.h"
+#include "../common/entitySet.h"
+#include "../common/allocTracker.h"
+#include "../common/perfCounters.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <numeric>
+#include <random>
+#include <string>
+#include <vector>
+
+
+using namespace std;
+
+
+struct opResult
+{
+    string pattern;
+    string op;
+    size_t ops = 0;
+    double nsPerOp = 0.0;
+    double allocsPerOp = 0.0;
+    double bytesPerOp = 0.0;
+    double missesPerOp = -1.0; //negative when counters are unavailable
+};
+
+//keeps reads from being optimised away
+static volatile float sink = 0.0f;
+
+static vector<opResult> results;
+
+
+//runs f once, which should perform ops operations, and records the cost per op
+template <typename F>
+void measureOp(const string & pattern, const string & op, size_t ops, F f)
+{
+    perfCounterGroup & counters = perfCounterGroup::thread();
+    perfSample before = counters.read();
+    allocSample allocsBefore = allocTracker::now();
+    auto start = chrono::steady_clock::now();
+    f();
+    auto end = chrono::steady_clock::now();
+    allocSample allocs = allocTracker::now() - allocsBefore;
+    perfSample delta = counters.read() - before;
+
+    opResult r;
+    r.pattern = pattern;
+    r.op = op;
+    r.ops = ops;
+    r.nsPerOp = chrono::duration<double, nano>(end - start).count() / ops;
+    r.allocsPerOp = double(allocs.count) / ops;
+    r.bytesPerOp = double(allocs.bytes) / ops;
+    if (counters.has(PERF_CACHE_MISSES)) r.missesPerOp = double(delta.values[PERF_CACHE_MISSES]) / ops;
+    results.push_back(r);
+}
+
+
+static void clearWorld(componentManager & cm)
+{
+    cm.clearAllComponents();
+}
+
+
+//adds the components of a demo rectangle
+static void addRect(componentManager & cm, entity e)
+{
+    cm.addComponent(e, positionComponent(1.0f, 2.0f));
+    cm.addComponent(e, rectangleSizeComponent(10, 10));
+    cm.addComponent(e, velocityComponent(1.0f, -1.0f));
+    cm.addComponent(e, colorComponent(255, 255, 255));
+    cm.addComponent(e, hitboxComponent(10, 10, 1));
+}
+
+
+//add, get, has, iterate, remove and clearEntityComponents over the given ids in order
+static void runPattern(const string & pattern, componentManager & cm, const vector<entity> & ids)
+{
+    size_t n = ids.size();
+    clearWorld(cm);
+
+    measureOp(pattern, "add", n, [&] {
+        for (const auto & e : ids) cm.addComponent(e, positionComponent(1.0f, 2.0f));
+    });
+
+    measureOp(pattern, "get", n, [&] {
+        float sum = 0.0f;
+        for (const auto & e : ids) sum += cm.getComponent<positionComponent>(e)->px;
+        sink = sum;
+    });
+
+    measureOp(pattern, "has", n, [&] {
+        size_t count = 0;
+        for (const auto & e : ids) count += cm.hasComponent<positionComponent>(e);
+        sink = static_cast<float>(count);
+    });
+
+    measureOp(pattern, "iterate", n, [&] {
+        float sum = 0.0f;
+        for (const auto & c : cm.getMap<positionComponent>()) sum += c.second.px;
+        sink = sum;
+    });
+
+    measureOp(pattern, "remove", n, [&] {
+        for (const auto & e : ids) cm.removeComponent<positionComponent>(e);
+    });
+
+    for (const auto & e : ids) addRect(cm, e);
+
+    measureOp(pattern, "clearEntityComponents", n, [&] {
+        for (const auto & e : ids) cm.clearEntityComponents(e);
+    });
+
+    clearWorld(cm);
+}
+
+
+//steady state spawn and destroy: each op deletes a random live rectangle and spawns a new one
+static void runChurn(componentManager & cm, size_t n, mt19937 & rng)
+{
+    clearWorld(cm);
+
+    vector<entity> live;
+    live.reserve(n);
+    uint32_t nextId = 0;
+    for (size_t i = 0; i < n; i++) {
+        entity e(nextId++);
+        addRect(cm, e);
+        live.push_back(e);
+    }
+
+    size_t ops = n;
+    vector<size_t> victims(ops);
+    for (auto & v : victims) v = uniform_int_distribution<size_t>(0, n - 1)(rng);
+
+    measureOp("churn", "destroy+spawn", ops, [&] {
+        for (size_t v : victims) {
+            cm.clearEntityComponents(live[v]);
+            entity e(nextId++);
+            addRect(cm, e);
+            live[v] = e;
+        }
+    });
+
+    measureOp("churn", "get", ops, [&] {
+        float sum = 0.0f;
+        for (size_t v : victims) sum += cm.getComponent<positionComponent>(live[v])->px;
+        sink = sum;
+    });
+
+    measureOp("churn", "iterate", cm.getMap<positionComponent>().size(), [&] {
+        float sum = 0.0f;
+        for (const auto & c : cm.getMap<positionComponent>()) sum += c.second.px;
+        sink = sum;
+    });
+
+    clearWorld(cm);
+}
+
+
+//the same churn with the rectangles spawned from a prefab pool, destroyed ones are released
+//to it and spawned again instead of being erased from every storage
+static void runPooledChurn(componentManager & cm, size_t n, mt19937 & rng)
+{
+    clearWorld(cm);
+
+    prefab rect;
+    rect.set(positionComponent(1.0f, 2.0f))
+        .set(rectangleSizeComponent(10, 10))
+        .set(velocityComponent(1.0f, -1.0f))
+        .set(colorComponent(255, 255, 255))
+        .set(hitboxComponent(10, 10, 1));
+    entityPool pool(rect);
+    pool.reserve(n);
+
+    vector<entity> live;
+    live.reserve(n);
+    uint32_t nextId = 0;
+    for (size_t i = 0; i < n; i++) live.push_back(pool.spawn(cm, nextId));
+
+    size_t ops = n;
+    vector<size_t> victims(ops);
+    for (auto & v : victims) v = uniform_int_distribution<size_t>(0, n - 1)(rng);
+
+    measureOp("pooled", "destroy+spawn", ops, [&] {
+        for (size_t v : victims) {
+            pool.release(cm, live[v]);
+            live[v] = pool.spawn(cm, nextId);
+        }
+    });
+
+    measureOp("pooled", "get", ops, [&] {
+        float sum = 0.0f;
+        for (size_t v : victims) sum += cm.getComponent<positionComponent>(live[v])->px;
+        sink = sum;
+    });
+
+    measureOp("pooled", "iterate", cm.getMap<positionComponent>().size(), [&] {
+        float sum = 0.0f;
+        for (const auto & c : cm.getMap<positionComponent>()) sum += c.second.px;
+        sink = sum;
+    });
+
+    clearWorld(cm);
+}
+
+
+//n rectangles spawned into an empty world, with one instantiate of a prefab and then one
+//addComponent at a time. Runs before the other patterns, which leave the map nodes scattered,
+//after an untimed spawn so neither pays for growing the storage the first time
+static void runSpawn(componentManager & cm, size_t n)
+{
+    clearWorld(cm);
+    for (size_t i = 0; i < n; i++) addRect(cm, entity(static_cast<int>(i)));
+    clearWorld(cm);
+
+    prefab rect;
+    rect.set(positionComponent(1.0f, 2.0f))
+        .set(rectangleSizeComponent(10, 10))
+        .set(velocityComponent(1.0f, -1.0f))
+        .set(colorComponent(255, 255, 255))
+        .set(hitboxComponent(10, 10, 1));
+
+    measureOp("spawn", "instantiate", n, [&] {
+        uint32_t nextId = 0;
+        entityRange rects = instantiate(cm, rect, n, nextId);
+        sink = static_cast<float>(rects.size());
+    });
+
+    clearWorld(cm);
+
+    measureOp("spawn", "addComponent", n, [&] {
+        for (size_t i = 0; i < n; i++) addRect(cm, entity(static_cast<int>(i)));
+    });
+
+    clearWorld(cm);
+}
+
+
+//erasing through a reference into the set itself, ents[k] and ents.back(), must leave every
+//other entity findable and the erased one gone
+static bool checkEntitySet()
+{
+    entitySet ents;
+    for (int i = 0; i < 8; i++) ents.insert(entity(i));
+
+    bool ok = true;
+    auto expect = [&](bool condition, const char * what) {
+        if (!condition) {
+            cerr << "entitySet: " << what << "\n";
+            ok = false;
+        }
+    };
+
+    //3 is erased while the last entity, 7, is moved into its slot
+    expect(ents.erase(ents[3]), "erase(ents[k]) failed");
+    expect(!ents.contains(entity(3)), "erase(ents[k]) left the erased id");
+    expect(ents.contains(entity(7)), "erase(ents[k]) dropped the moved entity");
+    expect(ents[3] == entity(7), "erase(ents[k]) did not move the last entity in");
+    expect(!ents.erase(entity(3)), "erasing the erased id again succeeded");
+
+    entity last = ents.back();
+    expect(ents.erase(ents.back()), "erase(ents.back()) failed");
+    expect(!ents.contains(last), "erase(ents.back()) left the erased id");
+
+    expect(ents.size() == 6, "wrong size after the erases");
+    for (size_t i = 0; i < ents.size(); i++) {
+        expect(ents.contains(ents[i]), "an entity in the set is not found");
+    }
+    return ok;
+}
+
+
+int main(int argc, char ** argv)
+{
+    size_t n = 100000;
+    uint32_t seed = 12345;
+
+    for (int i = 1; i + 1 < argc; i += 2) {
+        string arg = argv[i];
+        if (arg == "--n") n = max<size_t>(1, strtoul(argv[i + 1], nullptr, 10));
+        else if (arg == "--seed") seed = static_cast<uint32_t>(strtoul(argv[i + 1], nullptr, 10));
+        else {
+            cerr << "usage: " << argv[0] << " [--n entities] [--seed N]\n";
+            return 1;
+        }
+    }
+
+    if (!checkEntitySet()) return 1;
+
+    mt19937 rng(seed);
+    componentManager cm;
+
+    runSpawn(cm, n);
+
+    //ids 0..n-1 visited in order
+    vector<entity> sequential(n);
+    for (size_t i = 0; i < n; i++) sequential[i] = entity(static_cast<int>(i));
+    runPattern("sequential", cm, sequential);
+
+    //sparse ids visited in a shuffled order, one in sixteen ids of the range is used
+    //the range stays bounded because the manager keeps a signature per id up to the largest
+    vector<entity> random(n);
+    for (size_t i = 0; i < n; i++) random[i] = entity(static_cast<int>(rng() % (n * 16)));
+    sort(random.begin(), random.end(), [](const entity & a, const entity & b) { return a.entity_id < b.entity_id; });
+    random.erase(unique(random.begin(), random.end()), random.end());
+    shuffle(random.begin(), random.end(), rng);
+    runPattern("random", cm, random);
+
+    runChurn(cm, n, rng);
+    runPooledChurn(cm, n, rng);
+
+    cout << "pattern,op,ops,ns_per_op,allocs_per_op,bytes_per_op,cache_misses_per_op\n";
+    for (const auto & r : results) {
+        cout << r.pattern << ',' << r.op << ',' << r.ops << ',' << r.nsPerOp << ','
+             << r.allocsPerOp << ',' << r.bytesPerOp << ',' << r.missesPerOp << '\n';
+    }
+
+    return 0;
+}
@@ -0,0 +1,400 @@
+// Differential check and timing for the batched kernels in common/
+// Runs the scalar reference and every vector variant the CPU supports of the movement, AABB
+// overlap and circle rim kernels on copies of the same random input, and fails if any output
+// differs by a single bit. The input mixes in the awkward cases: signed zeros, NaN and infinite
+// values, positions right on the bounds, ids without their components, candidate ids past the
+// end of the arrays, and sizes that leave a scalar tail.
+// --kernels caps the levels that are checked, like it caps the demos. No display or SFML needed:
+//   g++ -std=c++20 -O2 -o kernelCheck kernelCheck.cpp
+
+#include "../common/movementKernel.h"
+#include "../common/overlapKernel.h"
+#include "../common/vertexKernel.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+
+using namespace std;
+
+
+//bitwise, so NaN payloads and the sign of zero have to match too
+template <typename T>
+static bool sameBits(const vector<T> & a, const vector<T> & b)
+{
+    return a.size() == b.size() && memcmp(a.data(), b.data(), a.size() * sizeof(T)) == 0;
+}
+
+
+//ns per item of f, best of a few runs
+template <typename F>
+static double timePerItem(size_t items, F f)
+{
+    double best = 1e30;
+    for (int run = 0; run < 20; run++) {
+        auto start = chrono::steady_clock::now();
+        f();
+        auto end = chrono::steady_clock::now();
+        best = min(best, chrono::duration<double, nano>(end - start).count() / items);
+    }
+    return best;
+}
+
+
+//bounds of the collision demos at their default window size
+constexpr double MIN_X(0 - 1600 * .2);
+constexpr double MAX_X(1600 * 1.2);
+constexpr double MIN_Y(0 - 900 * .2);
+constexpr double MAX_Y(900 * 1.2);
+
+
+//a value the bounds checks and sign tests have to get right
+static float edgeValue(mt19937 & rng)
+{
+    static const float edges[] = {
+        0.0f, -0.0f,
+        numeric_limits<float>::quiet_NaN(), numeric_limits<float>::infinity(), -numeric_limits<float>::infinity(),
+        numeric_limits<float>::denorm_min(), -numeric_limits<float>::denorm_min(),
+        float(MAX_X), float(MIN_X), float(MAX_Y), float(MIN_Y),
+        nextafter(float(MAX_X), INFINITY), nextafter(float(MIN_Y), -INFINITY),
+    };
+    return edges[rng() % (sizeof(edges) / sizeof(edges[0]))];
+}
+
+//the timings run on ordinary values, denormals and NaN would slow some kernels down
+static bool edgeCases = true;
+
+//mostly from dist, one in sixteen an edge value while checking
+template <typename D>
+static float pick(D & dist, mt19937 & rng)
+{
+    return edgeCases && rng() % 16 == 0 ? edgeValue(rng) : dist(rng);
+}
+
+
+//----- movement -----
+
+//arrays for one batch, copied so each kernel starts from the same state
+struct movementArrays
+{
+    vector<float> px, py, vx, vy, ax, ay;
+    vector<uint8_t> hasPosition, hasVelocity, hasAcceleration;
+
+    movementBatch batch(bool accelerate, float timestep)
+    {
+        movementBatch b;
+        b.px = px.data();
+        b.py = py.data();
+        b.vx = vx.data();
+        b.vy = vy.data();
+        if (accelerate) {
+            b.ax = ax.data();
+            b.ay = ay.data();
+        }
+        b.hasPosition = hasPosition.data();
+        b.hasVelocity = hasVelocity.data();
+        b.hasAcceleration = hasAcceleration.data();
+        b.count = px.size();
+        b.timestep = timestep;
+        b.minX = MIN_X;
+        b.maxX = MAX_X;
+        b.minY = MIN_Y;
+        b.maxY = MAX_Y;
+        return b;
+    }
+
+    bool operator==(const movementArrays & o) const
+    {
+        return sameBits(px, o.px) && sameBits(py, o.py) && sameBits(vx, o.vx) && sameBits(vy, o.vy);
+    }
+};
+
+static movementArrays randomMovement(size_t n, mt19937 & rng)
+{
+    uniform_real_distribution<float> position(-500.0f, 2500.0f);
+    uniform_real_distribution<float> velocity(-20.0f, 20.0f);
+    uniform_real_distribution<float> acceleration(0.0f, 5.0f);
+
+    movementArrays a;
+    for (size_t i = 0; i < n; i++) {
+        a.px.push_back(pick(position, rng));
+        a.py.push_back(pick(position, rng));
+        a.vx.push_back(pick(velocity, rng));
+        a.vy.push_back(pick(velocity, rng));
+        a.ax.push_back(pick(acceleration, rng));
+        a.ay.push_back(pick(acceleration, rng));
+        a.hasPosition.push_back(rng() % 8 != 0);
+        a.hasVelocity.push_back(rng() % 8 != 0);
+        a.hasAcceleration.push_back(rng() % 2);
+    }
+    return a;
+}
+
+static bool checkMovement(cpuLevel level, size_t n, mt19937 & rng)
+{
+    bool ok = true;
+
+    //odd sizes exercise the scalar tail, the timesteps are the demos' fixed and per frame ones
+    for (size_t size : {size_t(1), size_t(7), size_t(8), size_t(13), size_t(31), size_t(64), size_t(1000), n}) {
+        for (bool accelerate : {false, true}) {
+            for (float timestep : {1.0f, 1.0f / 60.0f}) {
+                movementArrays ref = randomMovement(size, rng);
+                movementArrays test = ref;
+
+                //stale bits must be overwritten, not merged
+                vector<uint8_t> refOob(movementSlots(size) / 8, 0xAA);
+                vector<uint8_t> testOob(refOob);
+
+                moveScalar(ref.batch(accelerate, timestep), 0, size, refOob.data());
+                movementKernel(level)(test.batch(accelerate, timestep), 0, size, testOob.data());
+
+                //bits past size are not written by either kernel
+                if (size % 8) {
+                    uint8_t keep = static_cast<uint8_t>((1u << (size % 8)) - 1);
+                    refOob.back() &= keep;
+                    testOob.back() &= keep;
+                }
+
+                if (!(ref == test) || refOob != testOob) {
+                    cerr << "movement " << cpuLevelName(level) << " differs from scalar, n " << size
+                         << (accelerate ? " with" : " without") << " acceleration, timestep " << timestep << "\n";
+                    ok = false;
+                }
+            }
+        }
+    }
+    return ok;
+}
+
+static double timeMovement(cpuLevel level, size_t n, bool accelerate, mt19937 & rng)
+{
+    movementArrays a = randomMovement(n, rng);
+    fill(a.hasPosition.begin(), a.hasPosition.end(), 1);
+    fill(a.hasVelocity.begin(), a.hasVelocity.end(), 1);
+    vector<uint8_t> oob(movementSlots(n) / 8);
+
+    movementBatch b = a.batch(accelerate, 1.0f / 60.0f);
+    movementFn kernel = movementKernel(level);
+    return timePerItem(n, [&] { kernel(b, 0, n, oob.data()); });
+}
+
+
+//----- overlap -----
+
+struct overlapArrays
+{
+    vector<float> px, py;
+    vector<int16_t> hx, hy;
+    vector<uint8_t> hasPosition, hasHitbox;
+
+    overlapBatch batch(float margin) const
+    {
+        overlapBatch b;
+        b.px = px.data();
+        b.py = py.data();
+        b.hx = hx.data();
+        b.hy = hy.data();
+        b.hasPosition = hasPosition.data();
+        b.hasHitbox = hasHitbox.data();
+        b.count = px.size();
+        b.margin = margin;
+        return b;
+    }
+};
+
+//a small world so a good share of the boxes overlap
+static overlapArrays randomBoxes(size_t n, mt19937 & rng)
+{
+    uniform_real_distribution<float> position(0.0f, 400.0f);
+    uniform_int_distribution<int32_t> extent(0, 40);
+
+    overlapArrays a;
+    for (size_t i = 0; i < n; i++) {
+        a.px.push_back(pick(position, rng));
+        a.py.push_back(pick(position, rng));
+        a.hx.push_back(static_cast<int16_t>(edgeCases && rng() % 32 == 0 ? -extent(rng) : extent(rng)));
+        a.hy.push_back(edgeCases && rng() % 32 == 0 ? INT16_MAX : static_cast<int16_t>(extent(rng)));
+        a.hasPosition.push_back(rng() % 8 != 0);
+        a.hasHitbox.push_back(rng() % 8 != 0);
+    }
+
+    //the slack past count that the gathers may read, like alignedArray's
+    a.hx.push_back(-1);
+    a.hy.push_back(-1);
+    return a;
+}
+
+static overlapBox randomBox(mt19937 & rng)
+{
+    uniform_real_distribution<float> position(0.0f, 400.0f);
+    uniform_int_distribution<int32_t> extent(0, 40);
+    return {pick(position, rng), pick(position, rng), extent(rng), extent(rng)};
+}
+
+//candidates in any order, with repeats and ids past the end of the arrays
+static vector<uint32_t> randomCandidates(size_t n, size_t count, mt19937 & rng)
+{
+    vector<uint32_t> ids;
+    for (size_t i = 0; i < n; i++) ids.push_back(static_cast<uint32_t>(rng() % (count + count / 4 + 1)));
+    return ids;
+}
+
+static bool checkOverlap(cpuLevel level, size_t n, mt19937 & rng)
+{
+    bool ok = true;
+
+    for (size_t size : {size_t(1), size_t(5), size_t(8), size_t(17), size_t(31), size_t(64), size_t(1000), n}) {
+        for (float margin : {0.1f, 0.01f}) {
+            overlapArrays a = randomBoxes(size, rng);
+            overlapBatch b = a.batch(margin);
+            vector<uint32_t> ids = randomCandidates(size, size, rng);
+
+            for (int query = 0; query < 32; query++) {
+                overlapBox box = randomBox(rng);
+
+                vector<uint32_t> ref(size), test(size);
+                ref.resize(overlapScalar(b, box, 0, size, ref.data()));
+                test.resize(overlapKernel(level)(b, box, 0, size, test.data()));
+
+                vector<uint32_t> refList(ids.size()), testList(ids.size());
+                refList.resize(overlapListScalar(b, box, ids.data(), ids.size(), refList.data()));
+                testList.resize(overlapListKernel(level)(b, box, ids.data(), ids.size(), testList.data()));
+
+                if (ref != test || refList != testList) {
+                    cerr << "overlap " << cpuLevelName(level) << " differs from scalar, n " << size
+                         << ", margin " << margin << "\n";
+                    ok = false;
+                    break;
+                }
+            }
+        }
+    }
+    return ok;
+}
+
+static double timeOverlap(cpuLevel level, size_t n, bool list, mt19937 & rng)
+{
+    overlapArrays a = randomBoxes(n, rng);
+    overlapBatch b = a.batch(0.1f);
+    vector<uint32_t> ids = randomCandidates(n, n, rng);
+    vector<uint32_t> out(n);
+    overlapBox box = randomBox(rng);
+
+    overlapFn range = overlapKernel(level);
+    overlapListFn candidates = overlapListKernel(level);
+    return timePerItem(n, [&] {
+        if (list) candidates(b, box, ids.data(), n, out.data());
+        else range(b, box, 0, n, out.data());
+    });
+}
+
+
+//----- circle rim -----
+
+static bool checkRim(cpuLevel level, mt19937 & rng)
+{
+    uniform_real_distribution<float> angle(0.0f, 6.2831853f);
+    uniform_real_distribution<float> position(-100.0f, 2000.0f);
+    uniform_real_distribution<float> radius(0.0f, 50.0f);
+
+    for (size_t n = 1; n <= 70; n++) {
+        vector<float> ux, uy;
+        for (size_t i = 0; i < n; i++) {
+            float a = angle(rng);
+            ux.push_back(rng() % 16 == 0 ? edgeValue(rng) : std::cos(a));
+            uy.push_back(rng() % 16 == 0 ? edgeValue(rng) : std::sin(a));
+        }
+
+        float cx = pick(position, rng);
+        float cy = pick(position, rng);
+        float r = pick(radius, rng);
+
+        vector<float> refX(n), refY(n), testX(n), testY(n);
+        rimScalar(ux.data(), uy.data(), n, cx, cy, r, refX.data(), refY.data());
+        circleRimKernel(level)(ux.data(), uy.data(), n, cx, cy, r, testX.data(), testY.data());
+
+        if (!sameBits(refX, testX) || !sameBits(refY, testY)) {
+            cerr << "circle rim " << cpuLevelName(level) << " differs from scalar, n " << n << "\n";
+            return false;
+        }
+    }
+    return true;
+}
+
+//keeps the rim timings from being optimised away
+static volatile float sink = 0.0f;
+
+//a frame's worth of demo circles, ns per rim point
+static double timeRim(cpuLevel level, size_t circles)
+{
+    constexpr size_t POINTS(31);
+    vector<float> ux(POINTS), uy(POINTS), x(POINTS), y(POINTS);
+    for (size_t i = 0; i < POINTS; i++) {
+        ux[i] = std::cos(i * 6.2831853f / (POINTS - 1));
+        uy[i] = std::sin(i * 6.2831853f / (POINTS - 1));
+    }
+
+    circleRimFn kernel = circleRimKernel(level);
+    return timePerItem(circles * POINTS, [&] {
+        for (size_t c = 0; c < circles; c++) {
+            kernel(ux.data(), uy.data(), POINTS, float(c), float(c), 10.0f, x.data(), y.data());
+            sink = x[c % POINTS];
+        }
+    });
+}
+
+
+int main(int argc, char ** argv)
+{
+    size_t n = 100000;
+    uint32_t seed = 1;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        string arg = argv[i];
+        cpuLevel level;
+        if (arg == "--n") n = max<size_t>(1, strtoul(argv[i + 1], nullptr, 10));
+        else if (arg == "--seed") seed = static_cast<uint32_t>(strtoul(argv[i + 1], nullptr, 10));
+        else if (arg == "--kernels" && cpuLevelFromName(argv[i + 1], level)) forceKernelLevel(level);
+        else {
+            cerr << "usage: " << argv[0] << " [--n entities] [--seed N] [--kernels scalar|sse42|avx2|avx512]\n";
+            return 1;
+        }
+    }
+
+    mt19937 rng(seed);
+    bool ok = true;
+
+    //every level up to the one in use, each against the scalar reference
+    cpuLevel top = kernelLevel();
+    cout << "cpu " << cpuLevelName(detectCpuLevel()) << ", checking up to " << cpuLevelName(top) << "\n";
+
+    for (int l = static_cast<int>(cpuLevel::sse42); l <= static_cast<int>(top); l++) {
+        cpuLevel level = static_cast<cpuLevel>(l);
+        ok = checkMovement(level, n, rng) && ok;
+        ok = checkOverlap(level, n, rng) && ok;
+        ok = checkRim(level, rng) && ok;
+    }
+
+    edgeCases = false;
+    cout << "level,movement_ns,movement_accel_ns,overlap_ns,overlap_list_ns,rim_ns\n";
+    for (int l = 0; l <= static_cast<int>(top); l++) {
+        cpuLevel level = static_cast<cpuLevel>(l);
+        cout << cpuLevelName(level) << ","
+             << timeMovement(level, n, false, rng) << ","
+             << timeMovement(level, n, true, rng) << ","
+             << timeOverlap(level, n, false, rng) << ","
+             << timeOverlap(level, n, true, rng) << ","
+             << timeRim(level, 1000) << "\n";
+    }
+
+    cout << (ok ? "all kernels match the scalar reference\n" : "kernel mismatch\n");
+    return ok ? 0 : 1;
+}
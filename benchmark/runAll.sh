@@ -0,0 +1,19 @@
+#!/bin/sh
+# Builds the benchmark for each physics path and runs the same sweep on all of them.
+# Extra arguments are passed to every run, results are merged into bench.csv
+set -e
+cd "$(dirname "$0")"
+
+SFML="-lsfml-graphics -lsfml-window -lsfml-system"
+
+for v in BRUTEFORCE THREADED QUADTREE; do
+    g++ -std=c++20 -O2 -DBENCH_$v -o bench_$v benchMain.cpp $SFML -pthread
+done
+
+rm -f bench.csv
+for v in BRUTEFORCE THREADED QUADTREE; do
+    ./bench_$v --csv bench_$v.csv "$@"
+    if [ -f bench.csv ]; then tail -n +2 bench_$v.csv >> bench.csv; else cat bench_$v.csv > bench.csv; fi
+done
+
+echo "results written to benchmark/bench.csv"
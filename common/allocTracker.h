@@ -0,0 +1,105 @@
+// Opt-in heap allocation tracker
+// Compile with -DTRACK_ALLOCS to replace the global operator new/delete with versions that
+// count every allocation made by the process. The replacements cannot be inline, so with the
+// flag set this header must end up in exactly one translation unit (every demo and benchmark
+// is a single one). Without the flag the counters stay at zero and nothing is replaced.
+//
+// allocTracker::now() returns running totals, the difference of two samples is what was
+// allocated in between by all threads. With -DPROFILE as well, every PROFILE_SCOPE records
+// that difference, so frame_stats.csv gets allocations and bytes per frame and per system.
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+//running allocation totals at one point in time
+struct allocSample
+{
+    std::uint64_t count = 0;
+    std::uint64_t bytes = 0;
+
+    allocSample operator-(const allocSample & o) const
+    {
+        return {count - o.count, bytes - o.bytes};
+    }
+};
+
+class allocTracker
+{
+    private:
+        static inline std::atomic<std::uint64_t> count{0};
+        static inline std::atomic<std::uint64_t> bytes{0};
+
+    public:
+        static constexpr bool enabled()
+        {
+#ifdef TRACK_ALLOCS
+            return true;
+#else
+            return false;
+#endif
+        }
+
+        //called by the replaced operator new
+        static void record(std::size_t size)
+        {
+            count.fetch_add(1, std::memory_order_relaxed);
+            bytes.fetch_add(size, std::memory_order_relaxed);
+        }
+
+        static allocSample now()
+        {
+            return {count.load(std::memory_order_relaxed), bytes.load(std::memory_order_relaxed)};
+        }
+};
+
+
+#ifdef TRACK_ALLOCS
+
+//gcc flags free() on memory from the replaced operator new once it inlines both
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+//the array and nothrow forms forward to these by default
+void * operator new(std::size_t size)
+{
+    allocTracker::record(size);
+    if (void * p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void * p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void * p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+//over-aligned types take a separate path that does not go through the plain operator new
+void * operator new(std::size_t size, std::align_val_t align)
+{
+    allocTracker::record(size);
+    std::size_t a = static_cast<std::size_t>(align);
+    std::size_t rounded = (size + a - 1) / a * a;
+    if (void * p = std::aligned_alloc(a, rounded ? rounded : a)) return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void * p, std::align_val_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void * p, std::size_t, std::align_val_t) noexcept
+{
+    std::free(p);
+}
+
+#endif
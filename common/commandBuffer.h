@@ -0,0 +1,155 @@
+// Deferred structural changes
+// Include after the demo's components.h, a buffer has a queue per type in its ComponentList.
+//
+// Systems must not create or destroy entities, or add and remove components, while they or
+// another thread iterate the entity set and component maps. They record the change into
+// a commandBuffer instead, one buffer per thread so recording needs no locks, and the owner
+// plays every buffer back at a sync point once the workers have joined:
+//
+//   commands[section].destroy(e);                //on a worker
+//   playbackCommands(commands, cm, ent);          //after join
+//
+// Playback goes type by type, so each component map is touched in one batch rather than
+// jumping between maps per command. Within a type, commands apply in the order they were
+// recorded, buffer by buffer. Order of a playback:
+//   1. created entities are inserted into the entity set
+//   2. component adds and removes, one component type at a time
+//   3. destroyed entities lose every component and are compacted out of the set in a
+//      single pass, so a destroy beats an add recorded for the same entity that frame
+//
+// Playback can also be given entity pools (common/entityPool.h). A destroyed entity that
+// one of them spawned is released back to it, its components hidden rather than erased.
+
+#pragma once
+
+#include "entitySet.h"
+#include "entityPool.h"
+
+#include <cstddef>
+#include <optional>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+//one queue of (entity, component) per type, an empty component means remove
+template <typename List>
+struct commandQueues;
+
+template <typename... Ts>
+struct commandQueues<std::tuple<Ts...>>
+{
+    using type = std::tuple<std::vector<std::pair<entity, std::optional<Ts>>>...>;
+};
+
+
+class commandBuffer;
+inline void playbackCommands(std::vector<commandBuffer> & buffers, const componentManager & cm, entitySet & ents,
+                             const std::vector<entityPool *> & pools = {});
+
+
+class commandBuffer
+{
+    private:
+        std::vector<entity> created;
+        std::vector<entity> destroyed;
+        typename commandQueues<ComponentList>::type components;
+
+        template <typename T>
+        auto & queue()
+        {
+            return std::get<std::vector<std::pair<entity, std::optional<T>>>>(components);
+        }
+
+        friend void playbackCommands(std::vector<commandBuffer> &, const componentManager &, entitySet &,
+                                     const std::vector<entityPool *> &);
+
+    public:
+        //entities a buffer can create and destroy in a frame before it has to grow
+        static constexpr std::size_t RESERVED_ENTITIES = 256;
+
+        //reserved up front so the odd entity dying mid run does not hit the heap in that frame
+        commandBuffer()
+        {
+            created.reserve(RESERVED_ENTITIES);
+            destroyed.reserve(RESERVED_ENTITIES);
+        }
+
+        //e already has its id, it is inserted into the entity set at playback
+        void create(const entity & e)
+        {
+            created.push_back(e);
+        }
+
+        void destroy(const entity & e)
+        {
+            destroyed.push_back(e);
+        }
+
+        template <typename T>
+        void add(const entity & e, const T & component)
+        {
+            queue<T>().emplace_back(e, component);
+        }
+
+        template <typename T>
+        void remove(const entity & e)
+        {
+            queue<T>().emplace_back(e, std::nullopt);
+        }
+
+        bool empty() const
+        {
+            bool none = created.empty() && destroyed.empty();
+            std::apply([&](const auto &... q) {
+                none = none && (... && q.empty());
+            }, components);
+            return none;
+        }
+
+        //drops everything recorded, capacity is kept for the next frame
+        void clear()
+        {
+            created.clear();
+            destroyed.clear();
+            std::apply([](auto &... q) {
+                (..., q.clear());
+            }, components);
+        }
+};
+
+
+//applies and clears every buffer, see the top of the file for the order
+inline void playbackCommands(std::vector<commandBuffer> & buffers, const componentManager & cm, entitySet & ents,
+                             const std::vector<entityPool *> & pools)
+{
+    for (auto & b : buffers) {
+        ents.insert(b.created.begin(), b.created.end());
+    }
+
+    std::apply([&](auto... type) {
+        ([&] {
+            using T = decltype(type);
+            for (auto & b : buffers) {
+                for (auto & [e, c] : b.template queue<T>()) {
+                    if (c) cm.addComponent(e, *c);
+                    else cm.removeComponent<T>(e);
+                }
+            }
+        }(), ...);
+    }, ComponentList{});
+
+    //every destroy is gathered into the first buffer so the set is compacted once, its
+    //capacity is kept between frames like the rest of the buffer
+    if (!buffers.empty()) {
+        std::vector<entity> & dead = buffers[0].destroyed;
+        for (std::size_t i = 1; i < buffers.size(); i++) {
+            dead.insert(dead.end(), buffers[i].destroyed.begin(), buffers[i].destroyed.end());
+        }
+        for (const auto & e : dead) {
+            if (!releaseToPool(pools, cm, e)) cm.clearEntityComponents(e);
+        }
+        ents.eraseMany(dead);
+    }
+
+    for (auto & b : buffers) b.clear();
+}
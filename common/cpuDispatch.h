@@ -0,0 +1,161 @@
+// Runtime selection of the vector kernels
+// One binary has to run on machines with and without AVX2 or AVX-512, so the kernel headers
+// build every variant of a kernel with a target attribute instead of relying on -march, and
+// pick one at runtime from what cpuid reports:
+//
+//   movementKernel(kernelLevel())(batch, 0, n, oob);
+//
+// kernelLevel() is the best level the CPU runs unless a lower one was forced. Forcing is how
+// every path gets tested on one machine: the collision demos and the benchmark take
+// --kernels scalar|sse42|avx2|avx512, and any program reads the LECS_KERNELS environment
+// variable the first time it asks for the level. A forced level the CPU lacks is lowered to
+// the best it has.
+//
+// Every variant of a kernel gives bit identical results, the kernels are written so the
+// vector lanes round exactly like the scalar code does. Code between KERNELS_BEGIN and
+// KERNELS_END is built without fused multiply-add, which GCC would otherwise form from the
+// separate multiplies and adds under -march=native or an avx512f target.
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define CPU_DISPATCH_X86
+#endif
+
+#if defined(__GNUC__) && !defined(__clang__)
+#define KERNELS_BEGIN _Pragma("GCC push_options") _Pragma("GCC optimize(\"fp-contract=off\")")
+#define KERNELS_END _Pragma("GCC pop_options")
+#else
+#define KERNELS_BEGIN
+#define KERNELS_END
+#endif
+
+//ordered, a level runs the kernels of every level below it
+enum class cpuLevel
+{
+    scalar,
+    sse42,
+    avx2,
+    avx512
+};
+
+constexpr int CPU_LEVEL_COUNT(4);
+
+
+inline const char * cpuLevelName(cpuLevel level)
+{
+    switch (level) {
+        case cpuLevel::sse42: return "sse42";
+        case cpuLevel::avx2: return "avx2";
+        case cpuLevel::avx512: return "avx512";
+        default: return "scalar";
+    }
+}
+
+//false if name is not one of the names cpuLevelName gives
+inline bool cpuLevelFromName(const std::string & name, cpuLevel & out)
+{
+    for (int i = 0; i < CPU_LEVEL_COUNT; i++) {
+        if (name == cpuLevelName(static_cast<cpuLevel>(i))) {
+            out = static_cast<cpuLevel>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+
+//best level this CPU and OS run, read from cpuid once
+inline cpuLevel detectCpuLevel()
+{
+    static const cpuLevel detected = [] {
+#ifdef CPU_DISPATCH_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f")) return cpuLevel::avx512;
+        if (__builtin_cpu_supports("avx2")) return cpuLevel::avx2;
+        if (__builtin_cpu_supports("sse4.2")) return cpuLevel::sse42;
+#endif
+        return cpuLevel::scalar;
+    }();
+    return detected;
+}
+
+
+//the detected level, lowered by LECS_KERNELS if it is set
+inline cpuLevel startupKernelLevel()
+{
+    cpuLevel level = detectCpuLevel();
+    const char * forced = std::getenv("LECS_KERNELS");
+    if (!forced) return level;
+
+    cpuLevel wanted;
+    if (!cpuLevelFromName(forced, wanted)) {
+        std::cerr << "unknown LECS_KERNELS value " << forced << ", using " << cpuLevelName(level) << "\n";
+        return level;
+    }
+    return wanted < level ? wanted : level;
+}
+
+
+inline std::atomic<cpuLevel> & activeKernelLevel()
+{
+    static std::atomic<cpuLevel> level(startupKernelLevel());
+    return level;
+}
+
+//level the dispatching kernels use
+inline cpuLevel kernelLevel()
+{
+    return activeKernelLevel().load(std::memory_order_relaxed);
+}
+
+//makes the kernels use level, or the best the CPU has if that is lower
+//returns the level in effect, call it before any worker threads start
+inline cpuLevel forceKernelLevel(cpuLevel level)
+{
+    cpuLevel detected = detectCpuLevel();
+    if (level > detected) level = detected;
+    activeKernelLevel().store(level, std::memory_order_relaxed);
+    return level;
+}
+
+
+#ifdef CPU_DISPATCH_X86
+
+//lane masks from the one byte per id live arrays the kernels read, all lanes set where
+//the byte is non zero
+
+__attribute__((target("sse4.2")))
+inline __m128 byteLanes4(const std::uint8_t * mask)
+{
+    std::int32_t bytes;
+    std::memcpy(&bytes, mask, sizeof(bytes));
+    __m128i wide = _mm_cvtepu8_epi32(_mm_cvtsi32_si128(bytes));
+    return _mm_castsi128_ps(_mm_cmpgt_epi32(wide, _mm_setzero_si128()));
+}
+
+__attribute__((target("avx2")))
+inline __m256 byteLanes8(const std::uint8_t * mask)
+{
+    __m128i bytes = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(mask));
+    __m256i wide = _mm256_cvtepu8_epi32(bytes);
+    return _mm256_castsi256_ps(_mm256_cmpgt_epi32(wide, _mm256_setzero_si256()));
+}
+
+//the zero masking form, GCC 12 warns about the undefined source of the plain one
+__attribute__((target("avx512f")))
+inline __mmask16 byteLanes16(const std::uint8_t * mask)
+{
+    __m512i wide = _mm512_maskz_cvtepu8_epi32(0xFFFF, _mm_loadu_si128(reinterpret_cast<const __m128i *>(mask)));
+    return _mm512_test_epi32_mask(wide, wide);
+}
+
+#endif
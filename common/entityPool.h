@@ -0,0 +1,114 @@
+// Recycling for short lived entities
+// Include after the demo's components.h, like prefab.h.
+//
+// Destroying an entity erases it from every component storage and spawning one adds it
+// back, which for the map backed types is a node free, a node allocation and two hash
+// updates each time. Scenes that keep spawning and destroying entities of the same kind,
+// projectiles or the shapes that leave the world, pay that on every one. An entityPool keeps
+// the destroyed entities of one prefab instead. release hides their components but leaves
+// them in their slots, and spawn hands a released entity back with the prefab's defaults
+// copied over the old values in place. A new id is only taken once none is left to reuse.
+//
+//   entityPool shots(shotPrefab);
+//   std::vector<entityPool *> pools{&shots};
+//
+//   entity s = shots.spawn(cm, entityId);        //then set its position and velocity
+//   ents.insert(s);
+//   ...
+//   commands[section].destroy(s);                //destroyed as usual,
+//   playbackCommands(commands, cm, ents, pools); //playback releases it to the pool
+//
+// A pool owns the ids it spawned for good, they are never handed out by anything else.
+// The collision demos only spawn while building the scene, so nothing would reuse what a pool
+// kept of the shapes leaving the world. They destroy without pools, and benchmark/
+// componentBench.cpp measures the pool against that.
+
+#pragma once
+
+#include "prefab.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class entityPool
+{
+    private:
+        //what every id the pool has spawned is doing, indexed by id
+        enum memberState : std::uint8_t
+        {
+            NOT_MEMBER,
+            LIVE,
+            RELEASED
+        };
+
+        prefab defaults;
+        std::vector<entity> released;
+        std::vector<memberState> members;
+
+        memberState stateOf(const entity & e) const
+        {
+            return e.entity_id < members.size() ? members[e.entity_id] : NOT_MEMBER;
+        }
+
+    public:
+        explicit entityPool(const prefab & p) : defaults(p) {}
+
+        const prefab & prefabOf() const { return defaults; }
+
+        //true for live and released entities of this pool
+        bool owns(const entity & e) const
+        {
+            return stateOf(e) != NOT_MEMBER;
+        }
+
+        //entities waiting to be spawned again
+        std::size_t idle() const { return released.size(); }
+
+        //a live entity with the prefab's components, reused if one was released
+        //otherwise it gets nextId, which is then incremented
+        template <typename Id>
+        entity spawn(const componentManager & cm, Id & nextId)
+        {
+            entity e;
+            if (!released.empty()) {
+                e = released.back();
+                released.pop_back();
+            } else {
+                e = entity(nextId++);
+                if (e.entity_id >= members.size()) members.resize(static_cast<std::size_t>(e.entity_id) + 1, NOT_MEMBER);
+            }
+
+            //the map entries are still there, so this only copies the defaults into them
+            defaults.applyTo(cm, e);
+            members[e.entity_id] = LIVE;
+            return e;
+        }
+
+        //hides a live entity of the pool until spawn reuses it
+        //false, and nothing done, if e is not a live entity of this pool
+        bool release(const componentManager & cm, const entity & e)
+        {
+            if (stateOf(e) != LIVE) return false;
+            cm.deactivateEntity(e);
+            members[e.entity_id] = RELEASED;
+            released.push_back(e);
+            return true;
+        }
+
+        //room for n released entities, so releasing up to n does not allocate
+        void reserve(std::size_t n)
+        {
+            released.reserve(n);
+        }
+};
+
+
+//releases e to the first pool that owns it, false if none does
+inline bool releaseToPool(const std::vector<entityPool *> & pools, const componentManager & cm, const entity & e)
+{
+    for (auto * p : pools) {
+        if (p->release(cm, e)) return true;
+    }
+    return false;
+}
@@ -0,0 +1,165 @@
+// Entity list with constant time membership and removal
+// Include after the demo's entity.h.
+//
+// A sparse set: the entities sit packed in a dense vector that systems iterate as before,
+// and a second vector indexed by entity id holds each entity's slot in it. That makes
+// contains() and erase() O(1) where the plain entity vector had to search:
+//
+//   ents.insert(e);
+//   ents.erase(e);               //moves the last entity into e's slot
+//   ents.eraseMany(dead);        //one pass over the set for a whole batch
+//
+// erase() swaps the last entity into the hole, so iteration order changes. eraseMany()
+// compacts instead, the survivors keep their order, which is what a frame's worth of
+// deletions wants: every removal is marked through the index first and the dense vector
+// is then walked once, however many entities go.
+// The index grows to the largest id inserted, ids are expected to be handed out densely
+// from a counter as the demos do.
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <type_traits>
+#include <vector>
+
+class entitySet
+{
+    private:
+        static constexpr std::uint32_t NONE = 0xFFFFFFFF;
+
+        std::vector<entity> dense;
+        std::vector<std::uint32_t> sparse;
+
+        std::uint32_t slot(const entity & e) const
+        {
+            return e.entity_id < sparse.size() ? sparse[e.entity_id] : NONE;
+        }
+
+    public:
+        using value_type = entity;
+        using const_iterator = std::vector<entity>::const_iterator;
+
+        entitySet() = default;
+
+        template <typename It>
+        entitySet(It first, It last)
+        {
+            assign(first, last);
+        }
+
+        //false if e is invalid or already in the set
+        bool insert(const entity & e)
+        {
+            if (!e.isValid() || contains(e)) return false;
+            if (e.entity_id >= sparse.size()) sparse.resize(static_cast<std::size_t>(e.entity_id) + 1, NONE);
+            sparse[e.entity_id] = static_cast<std::uint32_t>(dense.size());
+            dense.push_back(e);
+            return true;
+        }
+
+        //vector spelling of insert, so scene setup code reads the same as before
+        void push_back(const entity & e)
+        {
+            insert(e);
+        }
+
+        template <typename It>
+        void insert(It first, It last)
+        {
+            //ranges that can be measured are reserved for in one go, still growing at least
+            //geometrically so many small inserts stay linear
+            using category = typename std::iterator_traits<It>::iterator_category;
+            if constexpr (std::is_base_of_v<std::forward_iterator_tag, category>) {
+                std::size_t needed = dense.size() + static_cast<std::size_t>(std::distance(first, last));
+                if (needed > dense.capacity()) dense.reserve(std::max(needed, dense.capacity() * 2));
+            }
+            for (; first != last; ++first) insert(*first);
+        }
+
+        //replaces the contents, duplicates and invalid ids are dropped
+        template <typename It>
+        void assign(It first, It last)
+        {
+            clear();
+            insert(first, last);
+        }
+
+        bool contains(const entity & e) const
+        {
+            return slot(e) != NONE;
+        }
+
+        //swap-and-pop, false if e was not in the set
+        //e may be an element of the set, like ents[k] or ents.back(), so its id is copied
+        //before the slot it refers to is overwritten
+        bool erase(const entity & e)
+        {
+            const std::uint32_t id = e.entity_id;
+            std::uint32_t i = slot(e);
+            if (i == NONE) return false;
+
+            const entity last = dense.back();
+            dense[i] = last;
+            sparse[last.entity_id] = i;
+            dense.pop_back();
+            sparse[id] = NONE;
+            return true;
+        }
+
+        //removes every entity in [first, last) in one compaction pass, the survivors keep
+        //their order. Ids not in the set and repeats are ignored. Returns how many went.
+        template <typename It>
+        std::size_t eraseMany(It first, It last)
+        {
+            std::size_t marked = 0;
+            for (; first != last; ++first) {
+                std::uint32_t i = slot(*first);
+                if (i == NONE) continue;
+                sparse[first->entity_id] = NONE;
+                marked++;
+            }
+            if (marked == 0) return 0;
+
+            std::size_t out = 0;
+            for (std::size_t i = 0; i < dense.size(); i++) {
+                const entity e = dense[i];
+                if (sparse[e.entity_id] == NONE) continue;
+                sparse[e.entity_id] = static_cast<std::uint32_t>(out);
+                dense[out++] = e;
+            }
+            dense.resize(out);
+            return marked;
+        }
+
+        std::size_t eraseMany(const std::vector<entity> & dead)
+        {
+            return eraseMany(dead.begin(), dead.end());
+        }
+
+        //keeps the index allocation, only the ids in use are reset
+        void clear()
+        {
+            for (const auto & e : dense) sparse[e.entity_id] = NONE;
+            dense.clear();
+        }
+
+        void reserve(std::size_t n)
+        {
+            dense.reserve(n);
+        }
+
+        std::size_t size() const { return dense.size(); }
+        bool empty() const { return dense.empty(); }
+
+        const entity & operator[](std::size_t i) const { return dense[i]; }
+        const entity & back() const { return dense.back(); }
+        const entity * data() const { return dense.data(); }
+        const_iterator begin() const { return dense.begin(); }
+        const_iterator end() const { return dense.end(); }
+
+        //the packed entities, for code that takes a plain entity vector
+        const std::vector<entity> & entities() const { return dense; }
+};
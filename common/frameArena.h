@@ -0,0 +1,153 @@
+// Per frame scratch memory
+// Everything a physics step builds and throws away, the quadtree nodes, the candidate lists
+// and the collision logs, is bump allocated from a frameArena instead of the global heap.
+// The owner resets the arena once the frame is done, which only rewinds it, so the blocks
+// are kept and a frame that needs what the last one needed never calls malloc:
+//
+//   frameVector<entity> near{arenaAllocator<entity>(arenas[section])};
+//   uint32_t * ids = arenas[section].make<uint32_t>(n);
+//   ...
+//   for (auto & a : arenas) a.reset();            //after the workers are done
+//
+// An arena is not thread safe, give each thread section its own like the command buffers.
+// Nothing allocated from it is destroyed, only put trivially destructible types or
+// containers whose allocator is an arenaAllocator in it, and drop them before the reset.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+class frameArena
+{
+    private:
+        struct block
+        {
+            std::unique_ptr<unsigned char[]> data;
+            std::size_t size;
+        };
+
+        //blocks are never freed, a frame that outgrew them adds one and later frames reuse it
+        std::vector<block> blocks;
+
+        //block being bumped and the offset into it
+        std::size_t current = 0;
+        std::size_t offset = 0;
+
+        std::size_t blockSize;
+
+        //aligned start of bytes in block i at the offset, null if they do not fit
+        void * fit(std::size_t i, std::size_t from, std::size_t bytes, std::size_t align)
+        {
+            std::uintptr_t base = reinterpret_cast<std::uintptr_t>(blocks[i].data.get());
+            std::uintptr_t start = (base + from + align - 1) & ~(std::uintptr_t(align) - 1);
+            if (start - base + bytes > blocks[i].size) return nullptr;
+            current = i;
+            offset = start - base + bytes;
+            return reinterpret_cast<void *>(start);
+        }
+
+    public:
+        static constexpr std::size_t DEFAULT_BLOCK = std::size_t(1) << 16;
+
+        explicit frameArena(std::size_t firstBlock = DEFAULT_BLOCK) : blockSize(firstBlock) {}
+
+        frameArena(frameArena &&) = default;
+        frameArena & operator=(frameArena &&) = default;
+
+        //bytes aligned to align, which is a power of two
+        void * allocate(std::size_t bytes, std::size_t align = alignof(std::max_align_t))
+        {
+            if (!blocks.empty()) {
+                if (void * p = fit(current, offset, bytes, align)) return p;
+                for (std::size_t i = current + 1; i < blocks.size(); i++) {
+                    if (void * p = fit(i, 0, bytes, align)) return p;
+                }
+            }
+
+            //out of room, grow geometrically so a frame settles on a few blocks
+            std::size_t size = blocks.empty() ? blockSize : blocks.back().size * 2;
+            if (size < bytes + align) size = bytes + align;
+            blocks.push_back({std::unique_ptr<unsigned char[]>(new unsigned char[size]), size});
+            return fit(blocks.size() - 1, 0, bytes, align);
+        }
+
+        //room for n Ts, left uninitialised
+        template <typename T>
+        T * make(std::size_t n)
+        {
+            if (n > SIZE_MAX / sizeof(T)) throw std::bad_array_new_length();
+            return static_cast<T *>(allocate(n * sizeof(T), alignof(T)));
+        }
+
+        //one T built in place, its destructor never runs
+        template <typename T, typename... Args>
+        T * create(Args &&... args)
+        {
+            return new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+        }
+
+        //hands every byte back at once, the blocks stay for the next frame
+        void reset()
+        {
+            current = 0;
+            offset = 0;
+        }
+
+        //bytes given out since the last reset, counting the alignment padding
+        std::size_t used() const
+        {
+            std::size_t total = offset;
+            for (std::size_t i = 0; i < current; i++) total += blocks[i].size;
+            return total;
+        }
+
+        std::size_t capacity() const
+        {
+            std::size_t total = 0;
+            for (const auto & b : blocks) total += b.size;
+            return total;
+        }
+};
+
+
+//standard allocator over a frameArena, deallocate does nothing since reset frees everything
+template <typename T>
+struct arenaAllocator
+{
+    using value_type = T;
+
+    frameArena * arena;
+
+    arenaAllocator(frameArena & a) noexcept : arena(&a) {}
+
+    template <typename U>
+    arenaAllocator(const arenaAllocator<U> & other) noexcept : arena(other.arena) {}
+
+    T * allocate(std::size_t n)
+    {
+        return arena->make<T>(n);
+    }
+
+    void deallocate(T *, std::size_t) noexcept {}
+
+    template <typename U>
+    bool operator==(const arenaAllocator<U> & other) const noexcept
+    {
+        return arena == other.arena;
+    }
+
+    template <typename U>
+    bool operator!=(const arenaAllocator<U> & other) const noexcept
+    {
+        return arena != other.arena;
+    }
+};
+
+//vector whose storage lives until the arena is reset
+template <typename T>
+using frameVector = std::vector<T, arenaAllocator<T>>;
@@ -0,0 +1,230 @@
+// Frame time histograms shared by the demos and the benchmarks
+//
+// hdrHistogram keeps log-linear buckets (about 1% precision from 1ns up to ~18 minutes)
+// in a fixed array of atomics, so recording is O(1), allocation free and safe from any
+// thread. frameStats holds one histogram per name and writes p50/p90/p99/max for all of
+// them at the end of a run, plus per call hardware counter and heap allocation averages
+// for scopes that recorded them.
+
+#pragma once
+
+#include "allocTracker.h"
+#include "perfCounters.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+class hdrHistogram
+{
+    private:
+        //values below 2^SUB_BITS get their own bucket, above that each power of two
+        //is split into 2^(SUB_BITS - 1) buckets
+        static constexpr int SUB_BITS = 7;
+        static constexpr int HALF = 1 << (SUB_BITS - 1);
+
+        //largest recorded value is 2^MAX_BITS - 1 ns, bigger values are clamped
+        static constexpr int MAX_BITS = 40;
+        static constexpr int BUCKETS = (MAX_BITS - SUB_BITS + 2) * HALF;
+
+        std::atomic<std::uint64_t> buckets[BUCKETS] = {};
+        std::atomic<std::uint64_t> total{0};
+        std::atomic<std::uint64_t> sum{0};
+        std::atomic<std::uint64_t> largest{0};
+
+        static int bucketIndex(std::uint64_t v)
+        {
+            if (v < (1u << SUB_BITS)) return static_cast<int>(v);
+            int msb = 63 - __builtin_clzll(v);
+            int shift = msb - (SUB_BITS - 1);
+            return shift * HALF + static_cast<int>(v >> shift);
+        }
+
+        //largest value that lands in the bucket
+        static std::uint64_t bucketHigh(int idx)
+        {
+            if (idx < (1 << SUB_BITS)) return static_cast<std::uint64_t>(idx);
+            int shift = idx / HALF - 1;
+            std::uint64_t sub = static_cast<std::uint64_t>(idx % HALF + HALF);
+            return ((sub + 1) << shift) - 1;
+        }
+
+    public:
+        void record(std::uint64_t ns)
+        {
+            ns = std::min<std::uint64_t>(ns, (std::uint64_t{1} << MAX_BITS) - 1);
+
+            buckets[bucketIndex(ns)].fetch_add(1, std::memory_order_relaxed);
+            total.fetch_add(1, std::memory_order_relaxed);
+            sum.fetch_add(ns, std::memory_order_relaxed);
+
+            std::uint64_t prev = largest.load(std::memory_order_relaxed);
+            while (ns > prev && !largest.compare_exchange_weak(prev, ns, std::memory_order_relaxed)) {}
+        }
+
+        std::uint64_t count() const { return total.load(std::memory_order_relaxed); }
+        std::uint64_t max() const { return largest.load(std::memory_order_relaxed); }
+
+        double mean() const
+        {
+            std::uint64_t n = count();
+            return n ? static_cast<double>(sum.load(std::memory_order_relaxed)) / n : 0.0;
+        }
+
+        //value at or below which p percent of the recordings fall, within bucket precision
+        std::uint64_t percentile(double p) const
+        {
+            std::uint64_t n = count();
+            if (n == 0) return 0;
+
+            std::uint64_t target = static_cast<std::uint64_t>(std::ceil(p / 100.0 * n));
+            target = std::clamp<std::uint64_t>(target, 1, n);
+
+            std::uint64_t seen = 0;
+            for (int i = 0; i < BUCKETS; i++) {
+                seen += buckets[i].load(std::memory_order_relaxed);
+                if (seen >= target) return std::min(bucketHigh(i), max());
+            }
+            return max();
+        }
+
+        void reset()
+        {
+            for (auto & b : buckets) b.store(0, std::memory_order_relaxed);
+            total.store(0, std::memory_order_relaxed);
+            sum.store(0, std::memory_order_relaxed);
+            largest.store(0, std::memory_order_relaxed);
+        }
+};
+
+
+//named histograms for a whole run, one per frame/system scope
+class frameStats
+{
+    private:
+        struct entry
+        {
+            hdrHistogram times;
+
+            //summed counter deltas and how many scopes contributed to them
+            std::atomic<std::uint64_t> counters[PERF_COUNTER_COUNT] = {};
+            std::atomic<std::uint64_t> counterSamples{0};
+
+            //summed heap allocations, the most a single scope made, and the scope count
+            std::atomic<std::uint64_t> allocs{0};
+            std::atomic<std::uint64_t> allocBytes{0};
+            std::atomic<std::uint64_t> allocMax{0};
+            std::atomic<std::uint64_t> allocSamples{0};
+        };
+
+        std::mutex m;
+        std::map<std::string, std::unique_ptr<entry>> entries;
+
+        //entry for name, created on first use
+        //callers pass string literals, so each thread caches the lookup by pointer
+        entry & find(const char * name)
+        {
+            thread_local std::vector<std::pair<const char *, entry *>> cache;
+            for (const auto & c : cache) {
+                if (c.first == name) return *c.second;
+            }
+
+            std::lock_guard<std::mutex> lock(m);
+            auto & e = entries[name];
+            if (!e) e = std::make_unique<entry>();
+            cache.emplace_back(name, e.get());
+            return *e;
+        }
+
+    public:
+        static frameStats & get()
+        {
+            static frameStats s;
+            return s;
+        }
+
+        hdrHistogram & histogram(const char * name)
+        {
+            return find(name).times;
+        }
+
+        void record(const char * name, std::uint64_t ns)
+        {
+            find(name).times.record(ns);
+        }
+
+        //adds the counter deltas of one scope, only counters the group has open are summed
+        void recordCounters(const char * name, const perfSample & delta, const perfCounterGroup & group)
+        {
+            entry & e = find(name);
+            for (int i = 0; i < PERF_COUNTER_COUNT; i++) {
+                if (group.has(i)) e.counters[i].fetch_add(delta.values[i], std::memory_order_relaxed);
+            }
+            e.counterSamples.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        //adds the heap allocations made while one scope was open
+        void recordAllocs(const char * name, const allocSample & delta)
+        {
+            entry & e = find(name);
+            e.allocs.fetch_add(delta.count, std::memory_order_relaxed);
+            e.allocBytes.fetch_add(delta.bytes, std::memory_order_relaxed);
+            std::uint64_t prev = e.allocMax.load(std::memory_order_relaxed);
+            while (delta.count > prev && !e.allocMax.compare_exchange_weak(prev, delta.count, std::memory_order_relaxed)) {}
+            e.allocSamples.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        //one line per scope, times in milliseconds, counters and allocations averaged per call
+        //counter and allocation columns are empty for scopes that never recorded them
+        void writeReport(std::ostream & out)
+        {
+            std::lock_guard<std::mutex> lock(m);
+            out << "name,count,mean_ms,p50_ms,p90_ms,p99_ms,max_ms";
+            for (int i = 0; i < PERF_COUNTER_COUNT; i++) out << ',' << perfCounterName(i);
+            out << ",ipc,allocs,alloc_bytes,allocs_max\n";
+
+            for (const auto & [name, e] : entries) {
+                const hdrHistogram & h = e->times;
+                out << name << ',' << h.count() << ',' << h.mean() / 1e6 << ','
+                    << h.percentile(50) / 1e6 << ',' << h.percentile(90) / 1e6 << ','
+                    << h.percentile(99) / 1e6 << ',' << h.max() / 1e6;
+
+                std::uint64_t samples = e->counterSamples.load(std::memory_order_relaxed);
+                std::uint64_t cycles = e->counters[PERF_CYCLES].load(std::memory_order_relaxed);
+                for (int i = 0; i < PERF_COUNTER_COUNT; i++) {
+                    out << ',';
+                    std::uint64_t v = e->counters[i].load(std::memory_order_relaxed);
+                    if (samples && v) out << static_cast<double>(v) / samples;
+                }
+                out << ',';
+                if (samples && cycles) out << static_cast<double>(e->counters[PERF_INSTRUCTIONS].load(std::memory_order_relaxed)) / cycles;
+
+                std::uint64_t allocSamples = e->allocSamples.load(std::memory_order_relaxed);
+                out << ',';
+                if (allocSamples) {
+                    out << static_cast<double>(e->allocs.load(std::memory_order_relaxed)) / allocSamples << ','
+                        << static_cast<double>(e->allocBytes.load(std::memory_order_relaxed)) / allocSamples << ','
+                        << e->allocMax.load(std::memory_order_relaxed);
+                }
+                else out << ",,";
+                out << '\n';
+            }
+        }
+
+        bool writeReport(const std::string & path)
+        {
+            std::ofstream out(path);
+            if (!out) return false;
+            writeReport(out);
+            return static_cast<bool>(out);
+        }
+};
@@ -0,0 +1,272 @@
+// Memory mapped, read in place access to snapshots written by snapshot.h
+// Include after the demo's components.h.
+//
+// The file is mapped instead of read, and the entity tables and component arrays are used
+// where they sit in the mapping. Opening a snapshot costs the same whatever its size, and
+// only the pages a query touches are ever read from disk. That suits replay and analysis
+// tools that keep many captured worlds around:
+//
+//   mappedSnapshot snap("frame_1200.snap");
+//   for (const auto & p : snap.components<positionComponent>()) ...
+//   const velocityComponent * v = snap.getComponent<velocityComponent>(e);
+//
+// The mapping is private. editComponent() makes it writable, and the kernel then copies a page
+// only when it is first written, so the file on disk never changes.
+// promote() copies the snapshot into the live component storage so the simulation can resume
+// from it. It is a copy, not a copy on write mapping of the live arrays: the file keeps every
+// type as an array of whole components sorted by id, which is what the queries above read in
+// place, while the live componentManager keeps position, velocity and hitbox as one array
+// per field indexed by id, and every other type in hash maps. promote() adds each array in
+// bulk through componentManager::addComponents, like loadSnapshot does.
+// POSIX only. valid() is false on other platforms and on any file loadSnapshot would reject.
+
+#pragma once
+
+#include "snapshot.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+//a range of elements inside the mapping
+template <typename T>
+struct snapshotArray
+{
+    T * items = nullptr;
+    std::size_t count = 0;
+
+    T * begin() const { return items; }
+    T * end() const { return items + count; }
+    std::size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    T & operator[](std::size_t i) const { return items[i]; }
+};
+
+class mappedSnapshot
+{
+    private:
+        struct typeSection
+        {
+            const entity * ids = nullptr;
+            unsigned char * comps = nullptr;
+            std::size_t count = 0;
+        };
+
+        unsigned char * base = nullptr;
+        std::size_t length = 0;
+        bool writable = false;
+
+        std::vector<snapshotArray<const entity>> tables;
+        typeSection types[std::tuple_size_v<ComponentList>];
+
+        //walks the same layout snapshotReader does, false if the file does not fit it
+        bool parse()
+        {
+            std::size_t offset = 0;
+            auto take = [&](std::size_t bytes) -> unsigned char * {
+                if (bytes > length - offset) return nullptr;
+                unsigned char * p = base + offset;
+                offset += bytes;
+                return p;
+            };
+            auto align = [&]() { return take(snapshotPadding(offset)) != nullptr; };
+
+            auto * header = reinterpret_cast<snapshotHeader *>(take(sizeof(snapshotHeader)));
+            if (!header || std::memcmp(header->magic, "LECS", 4) != 0 || header->version != SNAPSHOT_VERSION ||
+                header->typeCount != std::tuple_size_v<ComponentList>) return false;
+
+            for (std::uint32_t i = 0; i < header->tableCount; i++) {
+                std::uint64_t count = 0;
+                unsigned char * c = take(sizeof(count));
+                if (!c || !align()) return false;
+                std::memcpy(&count, c, sizeof(count));
+
+                if (count > length / sizeof(entity)) return false;
+                auto * ids = reinterpret_cast<const entity *>(take(count * sizeof(entity)));
+                if (!ids || !align()) return false;
+                tables.push_back({ids, count});
+            }
+
+            bool ok = true;
+            std::size_t index = 0;
+            std::apply([&](auto... type) {
+                ([&] {
+                    using T = decltype(type);
+                    typeSection & section = types[index++];
+                    if (!ok) return;
+
+                    snapshotTypeHeader th;
+                    unsigned char * h = take(sizeof(th));
+                    if (!h || !align()) { ok = false; return; }
+                    std::memcpy(&th, h, sizeof(th));
+                    if (th.typeHash != snapshotTypeHash<T>() || th.size != sizeof(T) ||
+                        th.count > length / sizeof(T)) { ok = false; return; }
+
+                    section.count = th.count;
+                    section.ids = reinterpret_cast<const entity *>(take(th.count * sizeof(entity)));
+                    ok = section.ids && align();
+                    if (!ok) return;
+
+                    std::size_t compBytes = snapshotStored<T> ? th.count * sizeof(T) : 0;
+                    section.comps = take(compBytes);
+                    ok = section.comps && align();
+                }(), ...);
+            }, ComponentList{});
+
+            return ok;
+        }
+
+        void unmap()
+        {
+#if defined(__unix__) || defined(__APPLE__)
+            if (base) munmap(base, length);
+#endif
+            base = nullptr;
+            length = 0;
+            tables.clear();
+        }
+
+        //index of e in the id array of T, or count if it has no T
+        template <typename T>
+        std::size_t find(const entity & e) const
+        {
+            const typeSection & s = types[componentIndex<T>()];
+            const entity * it = std::lower_bound(s.ids, s.ids + s.count, e, [](const entity & a, const entity & b) {
+                return a.entity_id < b.entity_id;
+            });
+            return it != s.ids + s.count && *it == e ? static_cast<std::size_t>(it - s.ids) : s.count;
+        }
+
+    public:
+        explicit mappedSnapshot(const std::string & path)
+        {
+#if defined(__unix__) || defined(__APPLE__)
+            int fd = open(path.c_str(), O_RDONLY);
+            if (fd < 0) {
+                std::cerr << "could not open snapshot " << path << "\n";
+                return;
+            }
+
+            struct stat st;
+            if (fstat(fd, &st) == 0 && st.st_size > 0) {
+                length = static_cast<std::size_t>(st.st_size);
+                void * p = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (p != MAP_FAILED) base = static_cast<unsigned char *>(p);
+            }
+            close(fd);
+
+            if (!base || !parse()) {
+                std::cerr << path << " is not a snapshot of this component set\n";
+                unmap();
+            }
+#else
+            std::cerr << "mapped snapshots need POSIX mmap, use loadSnapshot instead of " << path << "\n";
+#endif
+        }
+
+        ~mappedSnapshot()
+        {
+            unmap();
+        }
+
+        mappedSnapshot(const mappedSnapshot &) = delete;
+        mappedSnapshot & operator=(const mappedSnapshot &) = delete;
+
+        bool valid() const
+        {
+            return base != nullptr;
+        }
+
+        std::size_t tableCount() const
+        {
+            return tables.size();
+        }
+
+        //entity set i as it was passed to saveSnapshot
+        snapshotArray<const entity> table(std::size_t i) const
+        {
+            return tables[i];
+        }
+
+        //every entity with a T, ascending, parallel to components<T>()
+        template <typename T>
+        snapshotArray<const entity> entities() const
+        {
+            const typeSection & s = types[componentIndex<T>()];
+            return {s.ids, s.count};
+        }
+
+        template <typename T>
+        snapshotArray<const T> components() const
+        {
+            static_assert(snapshotStored<T>, "this component type is not stored in snapshots");
+            const typeSection & s = types[componentIndex<T>()];
+            return {reinterpret_cast<const T *>(s.comps), s.count};
+        }
+
+        //same contract as componentManager::getComponent, binary search over the sorted ids
+        template <typename T>
+        const T * getComponent(const entity & e) const
+        {
+            std::size_t i = find<T>(e);
+            return i < types[componentIndex<T>()].count ? &components<T>()[i] : nullptr;
+        }
+
+        template <typename T>
+        bool hasComponent(const entity & e) const
+        {
+            return find<T>(e) < types[componentIndex<T>()].count;
+        }
+
+        //writable pointer into the mapping, the first write to a page copies it privately
+        //and the snapshot file is left unchanged
+        template <typename T>
+        T * editComponent(const entity & e)
+        {
+#if defined(__unix__) || defined(__APPLE__)
+            if (!writable) {
+                if (mprotect(base, length, PROT_READ | PROT_WRITE) != 0) return nullptr;
+                writable = true;
+            }
+#endif
+            return const_cast<T *>(getComponent<T>(e));
+        }
+
+        //replaces the live world with the snapshot, including any edits, like loadSnapshot does
+        //out must hold as many sets as the snapshot has
+        bool promote(const componentManager & cm, const std::vector<entitySet *> & out) const
+        {
+            if (!valid() || out.size() != tables.size()) return false;
+
+            for (std::size_t i = 0; i < tables.size(); i++) {
+                out[i]->assign(tables[i].begin(), tables[i].end());
+            }
+
+            cm.clearAllComponents();
+            std::apply([&](auto... type) {
+                ([&] {
+                    using T = decltype(type);
+                    if constexpr (snapshotStored<T>) {
+                        snapshotArray<const entity> ids = entities<T>();
+                        snapshotArray<const T> comps = components<T>();
+                        cm.addComponents(ids.begin(), comps.begin(), ids.size());
+                    }
+                }(), ...);
+            }, ComponentList{});
+
+            return true;
+        }
+};
@@ -0,0 +1,332 @@
+// Batched movement integration over structure of arrays storage
+// Works on raw arrays indexed by entity id, the layout common/soaStorage.h keeps position and
+// velocity in, so one call moves every entity of the world:
+//
+//   movementBatch b;  //px, py, vx, vy, live masks, bounds
+//   moveEntities(b, oob.data());
+//
+// For every id that has both a position and a velocity the kernel adds velocity * timestep to
+// the position, after optionally stepping the velocity by acceleration * timestep away from
+// zero the way ExtremePong speeds its ball up. In the same pass it writes an out of bounds
+// bitmask, bit (id % 8) of byte id / 8, which the systems turn into deletions.
+//
+// moveScalar is the reference and does exactly what the per entity movement systems did,
+// including their double precision bounds checks. The SSE4.2, AVX2 and AVX-512 kernels handle
+// 4, 8 and 16 ids at a time and give bit identical positions, velocities and masks: their
+// float bounds are the double bounds rounded inwards, which accepts and rejects exactly the
+// same floats. moveEntities picks one through common/cpuDispatch.h, and
+// benchmark/kernelCheck.cpp compares each of them against moveScalar.
+
+#pragma once
+
+#include "cpuDispatch.h"
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct movementBatch
+{
+    float * px = nullptr;
+    float * py = nullptr;
+    float * vx = nullptr;
+    float * vy = nullptr;
+
+    //optional, left null when nothing in the world accelerates
+    const float * ax = nullptr;
+    const float * ay = nullptr;
+
+    //1 for ids that have the component
+    const std::uint8_t * hasPosition = nullptr;
+    const std::uint8_t * hasVelocity = nullptr;
+    const std::uint8_t * hasAcceleration = nullptr;
+
+    //ids [0, count) are moved, every array must be at least count long
+    std::size_t count = 0;
+
+    float timestep = 1.0f;
+
+    //an entity is out of bounds once its position is beyond any of these
+    double minX = 0.0;
+    double maxX = 0.0;
+    double minY = 0.0;
+    double maxY = 0.0;
+};
+
+//moves ids [begin, end) and writes their bits of the mask
+//begin must be a multiple of 8 when several calls share one mask
+using movementFn = void (*)(const movementBatch &, std::size_t, std::size_t, std::uint8_t *);
+
+
+//count rounded up to whole vectors, the systems pad their arrays to this so the vector
+//kernels never need a scalar tail
+inline std::size_t movementSlots(std::size_t count)
+{
+    return (count + 7) / 8 * 8;
+}
+
+//true if bit id of a mask written by the kernels is set
+inline bool movementOutOfBounds(const std::vector<std::uint8_t> & oob, std::uint32_t id)
+{
+    return id / 8 < oob.size() && (oob[id / 8] >> (id % 8) & 1);
+}
+
+
+//largest float that is not above d, x > d and x > floatBelow(d) agree for every float x
+inline float floatBelow(double d)
+{
+    float f = static_cast<float>(d);
+    return static_cast<double>(f) > d ? std::nextafter(f, -INFINITY) : f;
+}
+
+//smallest float that is not below d, x < d and x < floatAbove(d) agree for every float x
+inline float floatAbove(double d)
+{
+    float f = static_cast<float>(d);
+    return static_cast<double>(f) < d ? std::nextafter(f, INFINITY) : f;
+}
+
+
+KERNELS_BEGIN
+
+//reference kernel
+inline void moveScalar(const movementBatch & b, std::size_t begin, std::size_t end, std::uint8_t * oob)
+{
+    //local copies, the byte stores into oob could alias anything the batch points at
+    float * px = b.px;
+    float * py = b.py;
+    float * vx = b.vx;
+    float * vy = b.vy;
+    const float * ax = b.ax;
+    const float * ay = b.ay;
+    const float t = b.timestep;
+    const double minX = b.minX, maxX = b.maxX, minY = b.minY, maxY = b.maxY;
+
+    //bits are collected per mask byte and written once
+    std::uint8_t bits = 0;
+    std::uint8_t touched = 0;
+
+    for (std::size_t i = begin; i < end; i++) {
+        bool out = false;
+
+        if (b.hasPosition[i] && b.hasVelocity[i]) {
+            if (ax && b.hasAcceleration[i]) {
+                float stepX = ax[i] * t;
+                float stepY = ay[i] * t;
+
+                if (vx[i] > 0) vx[i] += stepX;
+                else if (vx[i] < 0) vx[i] -= stepX;
+
+                if (vy[i] > 0) vy[i] += stepY;
+                else if (vy[i] < 0) vy[i] -= stepY;
+            }
+
+            float dx = vx[i] * t;
+            float dy = vy[i] * t;
+            px[i] += dx;
+            py[i] += dy;
+
+            out = (px[i] > maxX) | (px[i] < minX) | (py[i] > maxY) | (py[i] < minY);
+        }
+
+        bits |= static_cast<std::uint8_t>(out << (i % 8));
+        touched |= static_cast<std::uint8_t>(1u << (i % 8));
+        if (i % 8 == 7 || i + 1 == end) {
+            oob[i / 8] = static_cast<std::uint8_t>((oob[i / 8] & ~touched) | bits);
+            bits = 0;
+            touched = 0;
+        }
+    }
+}
+
+
+#ifdef CPU_DISPATCH_X86
+
+//velocity stepped by t away from zero, left alone where it is zero or NaN
+__attribute__((target("sse4.2")))
+inline __m128 movementAccelerate4(__m128 v, __m128 t, __m128 lanes)
+{
+    __m128 zero = _mm_setzero_ps();
+    __m128 pos = _mm_cmpgt_ps(v, zero);
+    __m128 neg = _mm_cmplt_ps(v, zero);
+    __m128 stepped = _mm_blendv_ps(_mm_sub_ps(v, t), _mm_add_ps(v, t), pos);
+    return _mm_blendv_ps(v, stepped, _mm_and_ps(lanes, _mm_or_ps(pos, neg)));
+}
+
+//four ids, returns their out of bounds bits
+__attribute__((target("sse4.2")))
+inline int moveSSE42Lanes(const movementBatch & b, std::size_t i, __m128 ts, __m128 minX, __m128 maxX, __m128 minY, __m128 maxY)
+{
+    __m128 live = _mm_and_ps(byteLanes4(b.hasPosition + i), byteLanes4(b.hasVelocity + i));
+    __m128 vx = _mm_loadu_ps(b.vx + i);
+    __m128 vy = _mm_loadu_ps(b.vy + i);
+
+    if (b.ax) {
+        __m128 acc = _mm_and_ps(live, byteLanes4(b.hasAcceleration + i));
+        vx = movementAccelerate4(vx, _mm_mul_ps(_mm_loadu_ps(b.ax + i), ts), acc);
+        vy = movementAccelerate4(vy, _mm_mul_ps(_mm_loadu_ps(b.ay + i), ts), acc);
+        _mm_storeu_ps(b.vx + i, vx);
+        _mm_storeu_ps(b.vy + i, vy);
+    }
+
+    __m128 px = _mm_loadu_ps(b.px + i);
+    __m128 py = _mm_loadu_ps(b.py + i);
+    px = _mm_blendv_ps(px, _mm_add_ps(px, _mm_mul_ps(vx, ts)), live);
+    py = _mm_blendv_ps(py, _mm_add_ps(py, _mm_mul_ps(vy, ts)), live);
+    _mm_storeu_ps(b.px + i, px);
+    _mm_storeu_ps(b.py + i, py);
+
+    __m128 out = _mm_or_ps(_mm_or_ps(_mm_cmpgt_ps(px, maxX), _mm_cmplt_ps(px, minX)),
+                           _mm_or_ps(_mm_cmpgt_ps(py, maxY), _mm_cmplt_ps(py, minY)));
+    return _mm_movemask_ps(_mm_and_ps(out, live));
+}
+
+//eight ids per iteration as two halves, so each iteration writes a whole mask byte
+__attribute__((target("sse4.2")))
+inline void moveSSE42(const movementBatch & b, std::size_t begin, std::size_t end, std::uint8_t * oob)
+{
+    const __m128 ts = _mm_set1_ps(b.timestep);
+    const __m128 minX = _mm_set1_ps(floatAbove(b.minX));
+    const __m128 maxX = _mm_set1_ps(floatBelow(b.maxX));
+    const __m128 minY = _mm_set1_ps(floatAbove(b.minY));
+    const __m128 maxY = _mm_set1_ps(floatBelow(b.maxY));
+
+    std::size_t i = begin;
+    for (; i + 8 <= end; i += 8) {
+        int low = moveSSE42Lanes(b, i, ts, minX, maxX, minY, maxY);
+        int high = moveSSE42Lanes(b, i + 4, ts, minX, maxX, minY, maxY);
+        oob[i / 8] = static_cast<std::uint8_t>(low | high << 4);
+    }
+
+    if (i < end) moveScalar(b, i, end, oob);
+}
+
+
+//velocity stepped by t away from zero, left alone where it is zero or NaN
+__attribute__((target("avx2")))
+inline __m256 movementAccelerate(__m256 v, __m256 t, __m256 lanes)
+{
+    __m256 zero = _mm256_setzero_ps();
+    __m256 pos = _mm256_cmp_ps(v, zero, _CMP_GT_OQ);
+    __m256 neg = _mm256_cmp_ps(v, zero, _CMP_LT_OQ);
+    __m256 stepped = _mm256_blendv_ps(_mm256_sub_ps(v, t), _mm256_add_ps(v, t), pos);
+    return _mm256_blendv_ps(v, stepped, _mm256_and_ps(lanes, _mm256_or_ps(pos, neg)));
+}
+
+//eight ids per iteration
+__attribute__((target("avx2")))
+inline void moveAVX2(const movementBatch & b, std::size_t begin, std::size_t end, std::uint8_t * oob)
+{
+    const __m256 ts = _mm256_set1_ps(b.timestep);
+    const __m256 minX = _mm256_set1_ps(floatAbove(b.minX));
+    const __m256 maxX = _mm256_set1_ps(floatBelow(b.maxX));
+    const __m256 minY = _mm256_set1_ps(floatAbove(b.minY));
+    const __m256 maxY = _mm256_set1_ps(floatBelow(b.maxY));
+
+    std::size_t i = begin;
+    for (; i + 8 <= end; i += 8) {
+        __m256 live = _mm256_and_ps(byteLanes8(b.hasPosition + i), byteLanes8(b.hasVelocity + i));
+        __m256 vx = _mm256_loadu_ps(b.vx + i);
+        __m256 vy = _mm256_loadu_ps(b.vy + i);
+
+        if (b.ax) {
+            __m256 acc = _mm256_and_ps(live, byteLanes8(b.hasAcceleration + i));
+            vx = movementAccelerate(vx, _mm256_mul_ps(_mm256_loadu_ps(b.ax + i), ts), acc);
+            vy = movementAccelerate(vy, _mm256_mul_ps(_mm256_loadu_ps(b.ay + i), ts), acc);
+            _mm256_storeu_ps(b.vx + i, vx);
+            _mm256_storeu_ps(b.vy + i, vy);
+        }
+
+        __m256 px = _mm256_loadu_ps(b.px + i);
+        __m256 py = _mm256_loadu_ps(b.py + i);
+        px = _mm256_blendv_ps(px, _mm256_add_ps(px, _mm256_mul_ps(vx, ts)), live);
+        py = _mm256_blendv_ps(py, _mm256_add_ps(py, _mm256_mul_ps(vy, ts)), live);
+        _mm256_storeu_ps(b.px + i, px);
+        _mm256_storeu_ps(b.py + i, py);
+
+        __m256 out = _mm256_or_ps(_mm256_or_ps(_mm256_cmp_ps(px, maxX, _CMP_GT_OQ), _mm256_cmp_ps(px, minX, _CMP_LT_OQ)),
+                                  _mm256_or_ps(_mm256_cmp_ps(py, maxY, _CMP_GT_OQ), _mm256_cmp_ps(py, minY, _CMP_LT_OQ)));
+        oob[i / 8] = static_cast<std::uint8_t>(_mm256_movemask_ps(_mm256_and_ps(out, live)));
+    }
+
+    if (i < end) moveScalar(b, i, end, oob);
+}
+
+
+//sixteen ids per iteration, the lane masks replace the blends
+__attribute__((target("avx512f")))
+inline void moveAVX512(const movementBatch & b, std::size_t begin, std::size_t end, std::uint8_t * oob)
+{
+    const __m512 ts = _mm512_set1_ps(b.timestep);
+    const __m512 zero = _mm512_setzero_ps();
+    const __m512 minX = _mm512_set1_ps(floatAbove(b.minX));
+    const __m512 maxX = _mm512_set1_ps(floatBelow(b.maxX));
+    const __m512 minY = _mm512_set1_ps(floatAbove(b.minY));
+    const __m512 maxY = _mm512_set1_ps(floatBelow(b.maxY));
+
+    std::size_t i = begin;
+    for (; i + 16 <= end; i += 16) {
+        __mmask16 live = byteLanes16(b.hasPosition + i) & byteLanes16(b.hasVelocity + i);
+        __m512 vx = _mm512_loadu_ps(b.vx + i);
+        __m512 vy = _mm512_loadu_ps(b.vy + i);
+
+        if (b.ax) {
+            __mmask16 acc = live & byteLanes16(b.hasAcceleration + i);
+            __m512 tx = _mm512_mul_ps(_mm512_loadu_ps(b.ax + i), ts);
+            __m512 ty = _mm512_mul_ps(_mm512_loadu_ps(b.ay + i), ts);
+
+            //the sign tests use the velocity from before either step, like the scalar else if
+            __mmask16 posX = _mm512_cmp_ps_mask(vx, zero, _CMP_GT_OQ) & acc;
+            __mmask16 negX = _mm512_cmp_ps_mask(vx, zero, _CMP_LT_OQ) & acc;
+            __mmask16 posY = _mm512_cmp_ps_mask(vy, zero, _CMP_GT_OQ) & acc;
+            __mmask16 negY = _mm512_cmp_ps_mask(vy, zero, _CMP_LT_OQ) & acc;
+            vx = _mm512_mask_sub_ps(_mm512_mask_add_ps(vx, posX, vx, tx), negX, vx, tx);
+            vy = _mm512_mask_sub_ps(_mm512_mask_add_ps(vy, posY, vy, ty), negY, vy, ty);
+            _mm512_storeu_ps(b.vx + i, vx);
+            _mm512_storeu_ps(b.vy + i, vy);
+        }
+
+        __m512 px = _mm512_loadu_ps(b.px + i);
+        __m512 py = _mm512_loadu_ps(b.py + i);
+        px = _mm512_mask_add_ps(px, live, px, _mm512_mul_ps(vx, ts));
+        py = _mm512_mask_add_ps(py, live, py, _mm512_mul_ps(vy, ts));
+        _mm512_storeu_ps(b.px + i, px);
+        _mm512_storeu_ps(b.py + i, py);
+
+        __mmask16 out = _mm512_cmp_ps_mask(px, maxX, _CMP_GT_OQ) | _mm512_cmp_ps_mask(px, minX, _CMP_LT_OQ) |
+                        _mm512_cmp_ps_mask(py, maxY, _CMP_GT_OQ) | _mm512_cmp_ps_mask(py, minY, _CMP_LT_OQ);
+        std::uint16_t bits = static_cast<std::uint16_t>(out & live);
+        oob[i / 8] = static_cast<std::uint8_t>(bits);
+        oob[i / 8 + 1] = static_cast<std::uint8_t>(bits >> 8);
+    }
+
+    if (i < end) moveScalar(b, i, end, oob);
+}
+
+#endif
+
+KERNELS_END
+
+
+//the movement kernel for level, scalar where the target has no vector kernels
+inline movementFn movementKernel(cpuLevel level)
+{
+#ifdef CPU_DISPATCH_X86
+    switch (level) {
+        case cpuLevel::avx512: return moveAVX512;
+        case cpuLevel::avx2: return moveAVX2;
+        case cpuLevel::sse42: return moveSSE42;
+        default: break;
+    }
+#endif
+    (void)level;
+    return moveScalar;
+}
+
+//moves every id in the batch with the kernel kernelLevel() selects
+//oob must hold movementSlots(b.count) / 8 bytes
+inline void moveEntities(const movementBatch & b, std::uint8_t * oob)
+{
+    movementKernel(kernelLevel())(b, 0, b.count, oob);
+}
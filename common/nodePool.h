@@ -0,0 +1,112 @@
+// Node allocator for the map backed component storages
+// std::unordered_map allocates every entry on its own, so adding a component to a map type
+// costs a malloc and removing it a free. The component maps use a nodeAllocator instead,
+// which carves their nodes out of chunks shared by every map with nodes of the same size:
+//
+//   std::unordered_map<entity, colorComponent, std::hash<entity>, std::equal_to<entity>,
+//                      nodeAllocator<std::pair<const entity, colorComponent>>> colors;
+//
+// A freed node goes on a free list and is handed out again by the next insert. Chunks grow
+// geometrically and are never given back, so spawning many entities in one go, like
+// instantiate in common/prefab.h does, takes a few chunk allocations rather than one per
+// entry. Bucket arrays and anything else that is not a single node go to the global heap.
+//
+// Not thread safe, add and remove components from one thread at a time like the maps
+// themselves.
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+template <std::size_t Size, std::size_t Align>
+class nodePool
+{
+    private:
+        union slot
+        {
+            slot * next;
+            alignas(Align) unsigned char bytes[Size];
+        };
+
+        static constexpr std::size_t FIRST_CHUNK = 64;
+        static constexpr std::size_t MAX_CHUNK = std::size_t(1) << 16;
+
+        std::vector<std::unique_ptr<slot[]>> chunks;
+        slot * freeList = nullptr;
+        std::size_t nextChunk = FIRST_CHUNK;
+
+        void grow()
+        {
+            std::unique_ptr<slot[]> chunk(new slot[nextChunk]);
+
+            //linked back to front so nodes are handed out in address order
+            for (std::size_t i = nextChunk; i-- > 0;) {
+                chunk[i].next = freeList;
+                freeList = &chunk[i];
+            }
+            chunks.push_back(std::move(chunk));
+            if (nextChunk < MAX_CHUNK) nextChunk *= 2;
+        }
+
+        nodePool() = default;
+
+    public:
+        nodePool(const nodePool &) = delete;
+        nodePool & operator=(const nodePool &) = delete;
+
+        //one pool per node size, never destroyed so maps torn down at exit can still free
+        //their nodes into it
+        static nodePool & instance()
+        {
+            static nodePool * pool = new nodePool;
+            return *pool;
+        }
+
+        void * allocate()
+        {
+            if (!freeList) grow();
+            slot * s = freeList;
+            freeList = s->next;
+            return s;
+        }
+
+        void deallocate(void * p)
+        {
+            slot * s = static_cast<slot *>(p);
+            s->next = freeList;
+            freeList = s;
+        }
+};
+
+
+//standard allocator that takes single objects from the nodePool of their size
+template <typename T>
+struct nodeAllocator
+{
+    using value_type = T;
+
+    nodeAllocator() noexcept = default;
+
+    template <typename U>
+    nodeAllocator(const nodeAllocator<U> &) noexcept {}
+
+    T * allocate(std::size_t n)
+    {
+        if (n == 1) return static_cast<T *>(nodePool<sizeof(T), alignof(T)>::instance().allocate());
+        return std::allocator<T>().allocate(n);
+    }
+
+    void deallocate(T * p, std::size_t n) noexcept
+    {
+        if (n == 1) nodePool<sizeof(T), alignof(T)>::instance().deallocate(p);
+        else std::allocator<T>().deallocate(p, n);
+    }
+
+    template <typename U>
+    bool operator==(const nodeAllocator<U> &) const noexcept { return true; }
+
+    template <typename U>
+    bool operator!=(const nodeAllocator<U> &) const noexcept { return false; }
+};
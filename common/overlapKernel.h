@@ -0,0 +1,352 @@
+// Batched AABB overlap tests over structure of arrays storage
+// The collision systems test one entity's hitbox against many others and only the few that
+// overlap need the face worked out. These kernels do the overlap test for a whole range of
+// ids, or a whole candidate list, and return just the hits:
+//
+//   overlapBatch b;  //position and hitbox arrays from soaStorage, margin
+//   size_t hits = findOverlaps(b, box, hitIds.data());
+//   size_t hits = findOverlapsIn(b, box, candidateIds, n, hitIndices.data());
+//
+// The test is the one collisionSystem::getCollisionFace starts with, boxes that come within
+// margin of each other count as overlapping:
+//   x < px + hx + margin && x + w > px - margin && y < py + hy + margin && y + h > py - margin
+// with the 16 bit extents converted to float first, as the systems' float + int does.
+// Ids that lack a position or a hitbox never overlap, and neither do candidate ids past the
+// end of the arrays. The query box overlaps itself if its own id is in range, callers skip it.
+// Hits come out in the order they were tested, ascending ids for a range and list order for a
+// candidate list, so the systems see collisions in the same order as their old loops.
+//
+// overlapScalar and overlapListScalar are the reference, the SSE4.2, AVX2 and AVX-512 kernels
+// test 4, 8 and 16 ids at a time with the same float operations and find exactly the same
+// hits. They widen the extents to 32 bit lanes as they load them, the candidate list kernels
+// gather them 32 bits at a time and keep the low half, so the extent arrays need two bytes of
+// slack past count, which alignedArray always has. findOverlaps and findOverlapsIn pick one
+// through common/cpuDispatch.h.
+
+#pragma once
+
+#include "cpuDispatch.h"
+
+#include <cstddef>
+#include <cstdint>
+
+struct overlapBatch
+{
+    //top left corners
+    const float * px = nullptr;
+    const float * py = nullptr;
+
+    //hitbox width and height, 16 bit like hitboxComponent
+    const std::int16_t * hx = nullptr;
+    const std::int16_t * hy = nullptr;
+
+    //1 for ids that have the component
+    const std::uint8_t * hasPosition = nullptr;
+    const std::uint8_t * hasHitbox = nullptr;
+
+    //every array is at least count long
+    std::size_t count = 0;
+
+    float margin = 0.0f;
+};
+
+//box tested against the batch, a position and a hitbox
+struct overlapBox
+{
+    float x;
+    float y;
+    std::int32_t w;
+    std::int32_t h;
+};
+
+//ids in [begin, end) that overlap box, written to out in ascending order
+//out must have room for end - begin ids, returns how many were written
+using overlapFn = std::size_t (*)(const overlapBatch &, const overlapBox &, std::size_t, std::size_t, std::uint32_t *);
+
+//indices k into ids[0, n) whose id overlaps box, written to out in ascending order
+//out must have room for n indices, returns how many were written
+using overlapListFn = std::size_t (*)(const overlapBatch &, const overlapBox &, const std::uint32_t *, std::size_t, std::uint32_t *);
+
+
+KERNELS_BEGIN
+
+inline bool overlapsScalar(const overlapBatch & b, const overlapBox & box, std::uint32_t id)
+{
+    float right = box.x + static_cast<float>(box.w);
+    float bottom = box.y + static_cast<float>(box.h);
+    float otherRight = b.px[id] + static_cast<float>(b.hx[id]);
+    float otherBottom = b.py[id] + static_cast<float>(b.hy[id]);
+
+    return b.hasPosition[id] && b.hasHitbox[id] &&
+           box.x < otherRight + b.margin && right > b.px[id] - b.margin &&
+           box.y < otherBottom + b.margin && bottom > b.py[id] - b.margin;
+}
+
+//reference kernel for ranges
+inline std::size_t overlapScalar(const overlapBatch & b, const overlapBox & box, std::size_t begin, std::size_t end, std::uint32_t * out)
+{
+    std::size_t hits = 0;
+    for (std::size_t i = begin; i < end; i++) {
+        if (overlapsScalar(b, box, static_cast<std::uint32_t>(i))) out[hits++] = static_cast<std::uint32_t>(i);
+    }
+    return hits;
+}
+
+//candidates [begin, n) one at a time, also the tail of the vector list kernels
+inline std::size_t overlapListFrom(const overlapBatch & b, const overlapBox & box, const std::uint32_t * ids,
+                                   std::size_t begin, std::size_t n, std::uint32_t * out)
+{
+    std::size_t hits = 0;
+    for (std::size_t k = begin; k < n; k++) {
+        if (ids[k] < b.count && overlapsScalar(b, box, ids[k])) out[hits++] = static_cast<std::uint32_t>(k);
+    }
+    return hits;
+}
+
+//reference kernel for candidate lists
+inline std::size_t overlapListScalar(const overlapBatch & b, const overlapBox & box, const std::uint32_t * ids, std::size_t n, std::uint32_t * out)
+{
+    return overlapListFrom(b, box, ids, 0, n, out);
+}
+
+
+//bit k set where ids[k] has both components, for the list kernels, width ids at most 32
+inline std::uint32_t overlapListLanes(const overlapBatch & b, const std::uint32_t * ids, int width)
+{
+    std::uint32_t lanes = 0;
+    for (int k = 0; k < width; k++) {
+        std::uint32_t id = ids[k];
+        if (id < b.count && b.hasPosition[id] && b.hasHitbox[id]) lanes |= 1u << k;
+    }
+    return lanes;
+}
+
+//writes first + the index of every set bit of bits
+inline std::size_t overlapEmit(std::uint32_t bits, std::size_t first, std::uint32_t * out)
+{
+    std::size_t hits = 0;
+    while (bits) {
+        out[hits++] = static_cast<std::uint32_t>(first + __builtin_ctz(bits));
+        bits &= bits - 1;
+    }
+    return hits;
+}
+
+
+#ifdef CPU_DISPATCH_X86
+
+//lanes of (px, py, hx, hy) that overlap the box
+__attribute__((target("sse4.2")))
+inline __m128 overlapLanes4(__m128 px, __m128 py, __m128i hxi, __m128i hyi, const overlapBox & box, float margin)
+{
+    const __m128 m = _mm_set1_ps(margin);
+    __m128 hx = _mm_cvtepi32_ps(hxi);
+    __m128 hy = _mm_cvtepi32_ps(hyi);
+    __m128 hitX = _mm_and_ps(_mm_cmplt_ps(_mm_set1_ps(box.x), _mm_add_ps(_mm_add_ps(px, hx), m)),
+                             _mm_cmpgt_ps(_mm_set1_ps(box.x + static_cast<float>(box.w)), _mm_sub_ps(px, m)));
+    __m128 hitY = _mm_and_ps(_mm_cmplt_ps(_mm_set1_ps(box.y), _mm_add_ps(_mm_add_ps(py, hy), m)),
+                             _mm_cmpgt_ps(_mm_set1_ps(box.y + static_cast<float>(box.h)), _mm_sub_ps(py, m)));
+    return _mm_and_ps(hitX, hitY);
+}
+
+__attribute__((target("sse4.2")))
+inline std::size_t overlapSSE42(const overlapBatch & b, const overlapBox & box, std::size_t begin, std::size_t end, std::uint32_t * out)
+{
+    std::size_t hits = 0;
+    std::size_t i = begin;
+    for (; i + 4 <= end; i += 4) {
+        __m128 live = _mm_and_ps(byteLanes4(b.hasPosition + i), byteLanes4(b.hasHitbox + i));
+        __m128 hit = overlapLanes4(_mm_loadu_ps(b.px + i), _mm_loadu_ps(b.py + i),
+                                   _mm_cvtepi16_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(b.hx + i))),
+                                   _mm_cvtepi16_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(b.hy + i))), box, b.margin);
+        hits += overlapEmit(static_cast<std::uint32_t>(_mm_movemask_ps(_mm_and_ps(hit, live))), i, out + hits);
+    }
+    return hits + overlapScalar(b, box, i, end, out + hits);
+}
+
+//no gathers before AVX2, the four candidates are loaded one by one
+__attribute__((target("sse4.2")))
+inline std::size_t overlapListSSE42(const overlapBatch & b, const overlapBox & box, const std::uint32_t * ids, std::size_t n, std::uint32_t * out)
+{
+    std::size_t hits = 0;
+    std::size_t k = 0;
+    for (; k + 4 <= n; k += 4) {
+        std::uint32_t lanes = overlapListLanes(b, ids + k, 4);
+        if (!lanes) continue;
+
+        //lanes without components read id 0, their result is masked off
+        std::uint32_t id[4];
+        for (int j = 0; j < 4; j++) id[j] = lanes >> j & 1 ? ids[k + j] : 0;
+
+        __m128 hit = overlapLanes4(_mm_setr_ps(b.px[id[0]], b.px[id[1]], b.px[id[2]], b.px[id[3]]),
+                                   _mm_setr_ps(b.py[id[0]], b.py[id[1]], b.py[id[2]], b.py[id[3]]),
+                                   _mm_setr_epi32(b.hx[id[0]], b.hx[id[1]], b.hx[id[2]], b.hx[id[3]]),
+                                   _mm_setr_epi32(b.hy[id[0]], b.hy[id[1]], b.hy[id[2]], b.hy[id[3]]), box, b.margin);
+        hits += overlapEmit(static_cast<std::uint32_t>(_mm_movemask_ps(hit)) & lanes, k, out + hits);
+    }
+    return hits + overlapListFrom(b, box, ids, k, n, out + hits);
+}
+
+
+__attribute__((target("avx2")))
+inline __m256 overlapLanes8(__m256 px, __m256 py, __m256i hxi, __m256i hyi, const overlapBox & box, float margin)
+{
+    const __m256 m = _mm256_set1_ps(margin);
+    __m256 hx = _mm256_cvtepi32_ps(hxi);
+    __m256 hy = _mm256_cvtepi32_ps(hyi);
+    __m256 hitX = _mm256_and_ps(_mm256_cmp_ps(_mm256_set1_ps(box.x), _mm256_add_ps(_mm256_add_ps(px, hx), m), _CMP_LT_OQ),
+                                _mm256_cmp_ps(_mm256_set1_ps(box.x + static_cast<float>(box.w)), _mm256_sub_ps(px, m), _CMP_GT_OQ));
+    __m256 hitY = _mm256_and_ps(_mm256_cmp_ps(_mm256_set1_ps(box.y), _mm256_add_ps(_mm256_add_ps(py, hy), m), _CMP_LT_OQ),
+                                _mm256_cmp_ps(_mm256_set1_ps(box.y + static_cast<float>(box.h)), _mm256_sub_ps(py, m), _CMP_GT_OQ));
+    return _mm256_and_ps(hitX, hitY);
+}
+
+__attribute__((target("avx2")))
+inline std::size_t overlapAVX2(const overlapBatch & b, const overlapBox & box, std::size_t begin, std::size_t end, std::uint32_t * out)
+{
+    std::size_t hits = 0;
+    std::size_t i = begin;
+    for (; i + 8 <= end; i += 8) {
+        __m256 live = _mm256_and_ps(byteLanes8(b.hasPosition + i), byteLanes8(b.hasHitbox + i));
+        __m256 hit = overlapLanes8(_mm256_loadu_ps(b.px + i), _mm256_loadu_ps(b.py + i),
+                                   _mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(b.hx + i))),
+                                   _mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(b.hy + i))), box, b.margin);
+        hits += overlapEmit(static_cast<std::uint32_t>(_mm256_movemask_ps(_mm256_and_ps(hit, live))), i, out + hits);
+    }
+    return hits + overlapScalar(b, box, i, end, out + hits);
+}
+
+//candidates are gathered, lanes without components are not loaded at all
+__attribute__((target("avx2")))
+inline std::size_t overlapListAVX2(const overlapBatch & b, const overlapBox & box, const std::uint32_t * ids, std::size_t n, std::uint32_t * out)
+{
+    const __m256i laneBits = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256i zeroi = _mm256_setzero_si256();
+
+    std::size_t hits = 0;
+    std::size_t k = 0;
+    for (; k + 8 <= n; k += 8) {
+        std::uint32_t lanes = overlapListLanes(b, ids + k, 8);
+        if (!lanes) continue;
+
+        __m256i idx = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(ids + k));
+        __m256i set = _mm256_and_si256(_mm256_set1_epi32(static_cast<int>(lanes)), laneBits);
+        __m256i loadi = _mm256_cmpeq_epi32(set, laneBits);
+        __m256 load = _mm256_castsi256_ps(loadi);
+
+        //extents are gathered as 32 bits at 2 byte strides, shifting up and back sign extends the low half
+        __m256i hx = _mm256_mask_i32gather_epi32(zeroi, reinterpret_cast<const int *>(b.hx), idx, loadi, 2);
+        __m256i hy = _mm256_mask_i32gather_epi32(zeroi, reinterpret_cast<const int *>(b.hy), idx, loadi, 2);
+        __m256 hit = overlapLanes8(_mm256_mask_i32gather_ps(zero, b.px, idx, load, 4),
+                                   _mm256_mask_i32gather_ps(zero, b.py, idx, load, 4),
+                                   _mm256_srai_epi32(_mm256_slli_epi32(hx, 16), 16),
+                                   _mm256_srai_epi32(_mm256_slli_epi32(hy, 16), 16), box, b.margin);
+        hits += overlapEmit(static_cast<std::uint32_t>(_mm256_movemask_ps(hit)) & lanes, k, out + hits);
+    }
+
+    return hits + overlapListFrom(b, box, ids, k, n, out + hits);
+}
+
+
+__attribute__((target("avx512f")))
+inline __mmask16 overlapLanes16(__m512 px, __m512 py, __m512i hxi, __m512i hyi, const overlapBox & box, float margin)
+{
+    const __m512 m = _mm512_set1_ps(margin);
+    //the zero masking form, like byteLanes16
+    __m512 hx = _mm512_maskz_cvtepi32_ps(0xFFFF, hxi);
+    __m512 hy = _mm512_maskz_cvtepi32_ps(0xFFFF, hyi);
+    return _mm512_cmp_ps_mask(_mm512_set1_ps(box.x), _mm512_add_ps(_mm512_add_ps(px, hx), m), _CMP_LT_OQ) &
+           _mm512_cmp_ps_mask(_mm512_set1_ps(box.x + static_cast<float>(box.w)), _mm512_sub_ps(px, m), _CMP_GT_OQ) &
+           _mm512_cmp_ps_mask(_mm512_set1_ps(box.y), _mm512_add_ps(_mm512_add_ps(py, hy), m), _CMP_LT_OQ) &
+           _mm512_cmp_ps_mask(_mm512_set1_ps(box.y + static_cast<float>(box.h)), _mm512_sub_ps(py, m), _CMP_GT_OQ);
+}
+
+__attribute__((target("avx512f")))
+inline std::size_t overlapAVX512(const overlapBatch & b, const overlapBox & box, std::size_t begin, std::size_t end, std::uint32_t * out)
+{
+    std::size_t hits = 0;
+    std::size_t i = begin;
+    for (; i + 16 <= end; i += 16) {
+        __mmask16 live = byteLanes16(b.hasPosition + i) & byteLanes16(b.hasHitbox + i);
+        //zero masking forms of the widening, like byteLanes16
+        __mmask16 hit = overlapLanes16(_mm512_loadu_ps(b.px + i), _mm512_loadu_ps(b.py + i),
+                                       _mm512_maskz_cvtepi16_epi32(0xFFFF, _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b.hx + i))),
+                                       _mm512_maskz_cvtepi16_epi32(0xFFFF, _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b.hy + i))), box, b.margin);
+        hits += overlapEmit(static_cast<std::uint32_t>(hit & live), i, out + hits);
+    }
+    return hits + overlapScalar(b, box, i, end, out + hits);
+}
+
+__attribute__((target("avx512f")))
+inline std::size_t overlapListAVX512(const overlapBatch & b, const overlapBox & box, const std::uint32_t * ids, std::size_t n, std::uint32_t * out)
+{
+    const __m512 zero = _mm512_setzero_ps();
+    const __m512i zeroi = _mm512_setzero_si512();
+
+    std::size_t hits = 0;
+    std::size_t k = 0;
+    for (; k + 16 <= n; k += 16) {
+        __mmask16 lanes = static_cast<__mmask16>(overlapListLanes(b, ids + k, 16));
+        if (!lanes) continue;
+
+        __m512i idx = _mm512_loadu_si512(ids + k);
+        __m512i hx = _mm512_mask_i32gather_epi32(zeroi, lanes, idx, b.hx, 2);
+        __m512i hy = _mm512_mask_i32gather_epi32(zeroi, lanes, idx, b.hy, 2);
+        //sign extends the low 16 bits, zero masking forms like byteLanes16
+        __mmask16 hit = overlapLanes16(_mm512_mask_i32gather_ps(zero, lanes, idx, b.px, 4),
+                                       _mm512_mask_i32gather_ps(zero, lanes, idx, b.py, 4),
+                                       _mm512_maskz_srai_epi32(0xFFFF, _mm512_maskz_slli_epi32(0xFFFF, hx, 16), 16),
+                                       _mm512_maskz_srai_epi32(0xFFFF, _mm512_maskz_slli_epi32(0xFFFF, hy, 16), 16), box, b.margin);
+        hits += overlapEmit(static_cast<std::uint32_t>(hit & lanes), k, out + hits);
+    }
+
+    return hits + overlapListFrom(b, box, ids, k, n, out + hits);
+}
+
+#endif
+
+KERNELS_END
+
+
+//the range kernel for level, scalar where the target has no vector kernels
+inline overlapFn overlapKernel(cpuLevel level)
+{
+#ifdef CPU_DISPATCH_X86
+    switch (level) {
+        case cpuLevel::avx512: return overlapAVX512;
+        case cpuLevel::avx2: return overlapAVX2;
+        case cpuLevel::sse42: return overlapSSE42;
+        default: break;
+    }
+#endif
+    (void)level;
+    return overlapScalar;
+}
+
+//the candidate list kernel for level
+inline overlapListFn overlapListKernel(cpuLevel level)
+{
+#ifdef CPU_DISPATCH_X86
+    switch (level) {
+        case cpuLevel::avx512: return overlapListAVX512;
+        case cpuLevel::avx2: return overlapListAVX2;
+        case cpuLevel::sse42: return overlapListSSE42;
+        default: break;
+    }
+#endif
+    (void)level;
+    return overlapListScalar;
+}
+
+//every id of the batch that overlaps box, with the kernel kernelLevel() selects
+inline std::size_t findOverlaps(const overlapBatch & b, const overlapBox & box, std::uint32_t * out)
+{
+    return overlapKernel(kernelLevel())(b, box, 0, b.count, out);
+}
+
+//every index into ids[0, n) whose id overlaps box
+inline std::size_t findOverlapsIn(const overlapBatch & b, const overlapBox & box, const std::uint32_t * ids, std::size_t n, std::uint32_t * out)
+{
+    return overlapListKernel(kernelLevel())(b, box, ids, n, out);
+}
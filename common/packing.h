@@ -0,0 +1,76 @@
+// Narrow encodings for cold component fields
+// Colors, hitbox extents and texture names are small values that were stored as ints and
+// strings. The components keep them in the smallest type that fits instead: channels as
+// bytes (RGBA8), extents as 16 bit ints and file names as ids into a nameTable. Their
+// constructors still take ints and strings and convert at the boundary, clamping values
+// that do not fit:
+//
+//   colorComponent(300, -5, 128)          //stored as 255, 0, 128 with alpha 255
+//   hitboxComponent(40000, 10, 1)         //width stored as 32767
+//   textureComponent("ball.png")          //stored as the id of "ball.png"
+//   h->x = packExtent(w);                 //writing a field directly converts the same way
+//
+// A color is 4 bytes instead of 12 and a hitbox takes 5 bytes of its arrays per entity instead
+// of 9, so the render and collision loops pull fewer cache lines per entity.
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+//a color channel clamped to 0-255
+constexpr std::uint8_t packChannel(int value)
+{
+    return static_cast<std::uint8_t>(std::clamp(value, 0, 255));
+}
+
+//a hitbox extent clamped to the 16 bit range
+constexpr std::int16_t packExtent(int value)
+{
+    return static_cast<std::int16_t>(std::clamp<int>(value, std::numeric_limits<std::int16_t>::min(),
+                                                     std::numeric_limits<std::int16_t>::max()));
+}
+
+
+//interned strings, each distinct string is stored once and named by its index
+//id 0 is the empty string
+//not thread safe, intern while building the scene, reads may then come from any thread
+class nameTable
+{
+    private:
+        std::vector<std::string> names{std::string()};
+        std::unordered_map<std::string, std::uint32_t> ids{{std::string(), 0}};
+
+    public:
+        //table shared by every component of the process, like the component maps
+        static nameTable & global()
+        {
+            static nameTable table;
+            return table;
+        }
+
+        //id of name, adding it if it is new
+        std::uint32_t intern(const std::string & name)
+        {
+            auto it = ids.find(name);
+            if (it != ids.end()) return it->second;
+
+            std::uint32_t id = static_cast<std::uint32_t>(names.size());
+            names.push_back(name);
+            ids.emplace(name, id);
+            return id;
+        }
+
+        //string of id, the empty string for ids that were never handed out
+        const std::string & name(std::uint32_t id) const
+        {
+            return id < names.size() ? names[id] : names[0];
+        }
+
+        std::size_t size() const { return names.size(); }
+};
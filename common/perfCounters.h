@@ -0,0 +1,153 @@
+// Hardware performance counters through Linux perf_event_open
+//
+// perfCounterGroup opens cycles, instructions, cache misses and branch misses as one
+// group for the calling thread so they are scheduled together and read in one syscall.
+// Counters that cannot be opened (containers, VMs, perf_event_paranoid, other OSes)
+// are reported as missing instead of failing, so the same build runs everywhere.
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+enum perfCounter
+{
+    PERF_CYCLES,
+    PERF_INSTRUCTIONS,
+    PERF_CACHE_MISSES,
+    PERF_BRANCH_MISSES,
+    PERF_COUNTER_COUNT
+};
+
+inline const char * perfCounterName(int c)
+{
+    static const char * names[PERF_COUNTER_COUNT] = {"cycles", "instructions", "cache_misses", "branch_misses"};
+    return names[c];
+}
+
+//counter values at one point in time, zero for counters that are not open
+struct perfSample
+{
+    std::uint64_t values[PERF_COUNTER_COUNT] = {};
+
+    perfSample operator-(const perfSample & other) const
+    {
+        perfSample d;
+        for (int i = 0; i < PERF_COUNTER_COUNT; i++) d.values[i] = values[i] - other.values[i];
+        return d;
+    }
+};
+
+
+class perfCounterGroup
+{
+    private:
+        int leader = -1;
+        int fds[PERF_COUNTER_COUNT];
+
+        //position of each counter in the group read, -1 if it could not be opened
+        int slot[PERF_COUNTER_COUNT];
+        int opened = 0;
+
+#ifdef __linux__
+        int open(std::uint64_t config, int groupFd)
+        {
+            perf_event_attr attr;
+            std::memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = config;
+            attr.disabled = groupFd < 0 ? 1 : 0;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_GROUP;
+            return static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, groupFd, 0));
+        }
+#endif
+
+    public:
+        perfCounterGroup()
+        {
+            for (int i = 0; i < PERF_COUNTER_COUNT; i++) {
+                fds[i] = -1;
+                slot[i] = -1;
+            }
+
+#ifdef __linux__
+            const std::uint64_t configs[PERF_COUNTER_COUNT] = {
+                PERF_COUNT_HW_CPU_CYCLES,
+                PERF_COUNT_HW_INSTRUCTIONS,
+                PERF_COUNT_HW_CACHE_MISSES,
+                PERF_COUNT_HW_BRANCH_MISSES
+            };
+
+            //the first counter that opens leads the group, the rest join it
+            for (int i = 0; i < PERF_COUNTER_COUNT; i++) {
+                int fd = open(configs[i], leader);
+                if (fd < 0) continue;
+                if (leader < 0) leader = fd;
+                fds[i] = fd;
+                slot[i] = opened++;
+            }
+
+            if (leader >= 0) {
+                ioctl(leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+                ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+            }
+#endif
+        }
+
+        ~perfCounterGroup()
+        {
+#ifdef __linux__
+            for (int fd : fds) {
+                if (fd >= 0) close(fd);
+            }
+#endif
+        }
+
+        perfCounterGroup(const perfCounterGroup &) = delete;
+        perfCounterGroup & operator=(const perfCounterGroup &) = delete;
+
+        bool available() const { return leader >= 0; }
+        bool has(int c) const { return slot[c] >= 0; }
+
+        //current values of every open counter, counting since the group was created
+        perfSample read() const
+        {
+            perfSample s;
+#ifdef __linux__
+            if (leader < 0) return s;
+
+            //group read layout is the counter count followed by one value per counter
+            std::uint64_t buf[1 + PERF_COUNTER_COUNT] = {};
+            if (::read(leader, buf, sizeof(buf)) < static_cast<ssize_t>(sizeof(std::uint64_t))) return s;
+
+            for (int i = 0; i < PERF_COUNTER_COUNT; i++) {
+                if (slot[i] >= 0 && static_cast<std::uint64_t>(slot[i]) < buf[0]) s.values[i] = buf[1 + slot[i]];
+            }
+#endif
+            return s;
+        }
+
+        //group for the calling thread, opened on first use and closed when the thread exits
+        static perfCounterGroup & thread()
+        {
+            thread_local perfCounterGroup group;
+
+            static std::atomic<bool> warned{false};
+            if (!group.available() && !warned.exchange(true)) {
+                std::cerr << "Hardware perf counters unavailable, reporting timings only\n";
+            }
+            return group;
+        }
+};
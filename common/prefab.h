@@ -0,0 +1,128 @@
+// Prefabs: the default component values of one kind of entity
+// Include after the demo's components.h, a prefab can hold any type in its ComponentList.
+//
+//   prefab bullet;
+//   bullet.set(velocityComponent(8, 0))
+//         .set(hitboxComponent(4, 4, 1))
+//         .set(colorComponent(255, 255, 0));
+//   bullet.applyTo(cm, e);                       //gives e every component of the prefab
+//
+// instantiate makes many entities of a prefab at once. They get consecutive ids, and each
+// component type is written for the whole range in one pass with its storage reserved up
+// front, rather than entity by entity and type by type:
+//
+//   entityRange shots = instantiate(cm, bullet, 100000, entityId);
+//   ents.insert(shots.begin(), shots.end());
+//   for (entity e : shots) cm.getComponent<positionComponent>(e)->px = ...;
+//
+// The prefab only stores values, entityPool (common/entityPool.h) uses one to recycle
+// entities of the same kind.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <optional>
+#include <tuple>
+
+//one optional default per type
+template <typename List>
+struct prefabValues;
+
+template <typename... Ts>
+struct prefabValues<std::tuple<Ts...>>
+{
+    using type = std::tuple<std::optional<Ts>...>;
+};
+
+
+class prefab
+{
+    private:
+        typename prefabValues<ComponentList>::type defaults;
+        componentMask mask = 0;
+
+    public:
+        //sets the default of T, adding T to the prefab if it was not in it
+        template <typename T>
+        prefab & set(const T & component)
+        {
+            std::get<std::optional<T>>(defaults) = component;
+            mask |= componentMaskOf<T>();
+            return *this;
+        }
+
+        //default of T, null if the prefab has no T
+        template <typename T>
+        const T * get() const
+        {
+            const auto & v = std::get<std::optional<T>>(defaults);
+            return v ? &*v : nullptr;
+        }
+
+        //bits of every component type in the prefab
+        componentMask signature() const { return mask; }
+
+        //the optional default of every type in ComponentList
+        const typename prefabValues<ComponentList>::type & values() const { return defaults; }
+
+        //writes every default to e, over the values e already has
+        void applyTo(const componentManager & cm, const entity & e) const
+        {
+            std::apply([&](const auto &... v) {
+                (..., (v ? cm.addComponent(e, *v) : void()));
+            }, defaults);
+        }
+};
+
+
+//count entities with consecutive ids starting at first
+struct entityRange
+{
+    std::uint32_t first = 0;
+    std::size_t count = 0;
+
+    class iterator
+    {
+        private:
+            std::uint32_t id;
+
+        public:
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = entity;
+            using difference_type = std::ptrdiff_t;
+            using pointer = const entity *;
+            using reference = entity;
+
+            explicit iterator(std::uint32_t i) : id(i) {}
+
+            entity operator*() const { return entity(id); }
+            iterator & operator++() { id++; return *this; }
+            bool operator==(const iterator & other) const { return id == other.id; }
+            bool operator!=(const iterator & other) const { return id != other.id; }
+    };
+
+    std::size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    entity operator[](std::size_t i) const { return entity(first + i); }
+    iterator begin() const { return iterator(first); }
+    iterator end() const { return iterator(static_cast<std::uint32_t>(first + count)); }
+};
+
+
+//count new entities with every component of p, ids are taken from nextId which ends up
+//one past the last of them
+template <typename Id>
+entityRange instantiate(const componentManager & cm, const prefab & p, std::size_t count, Id & nextId)
+{
+    entityRange range;
+    range.first = static_cast<std::uint32_t>(nextId);
+    range.count = count;
+    nextId += static_cast<Id>(count);
+
+    std::apply([&](const auto &... v) {
+        (..., (v ? cm.addComponentRange(entity(range.first), count, *v) : void()));
+    }, p.values());
+    return range;
+}
@@ -0,0 +1,225 @@
+// Scoped profiler shared by the demos
+// Compile with -DPROFILE to record, otherwise the macros compile to nothing.
+//
+// PROFILE_SCOPE("name") times the rest of the enclosing scope and records it into
+// a ring buffer owned by the calling thread. PROFILE_DUMP("trace.json") writes every
+// recorded span as Chrome trace-event JSON (open it in chrome://tracing or Perfetto).
+// Every scope is also recorded into the frameStats histogram of the same name, and
+// PROFILE_REPORT("frame_stats.csv") writes p50/p90/p99/max for each of them.
+// Also defining PROFILE_COUNTERS reads the hardware counter group of the thread around
+// every scope and adds cycles, instructions, cache and branch misses and IPC to the report.
+// With TRACK_ALLOCS (see allocTracker.h) each scope also records the heap allocations made
+// while it was open, by any thread.
+// Names must be string literals, only the pointer is stored.
+
+#pragma once
+
+#include "frameStats.h"
+
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+//events kept per thread before the oldest ones are overwritten
+#ifndef PROFILE_RING_SIZE
+#define PROFILE_RING_SIZE (1 << 16)
+#endif
+
+//a finished span, times are nanoseconds since the profiler started
+struct profileEvent
+{
+    const char * name = nullptr;
+    std::int64_t start = 0;
+    std::int64_t end = 0;
+};
+
+//fixed size ring of events, only ever written by the thread holding it
+class profileRing
+{
+    public:
+        std::vector<profileEvent> events;
+
+        //total events pushed, the ring holds the last PROFILE_RING_SIZE of them
+        std::uint64_t count = 0;
+
+        //id shown as the thread in the trace
+        std::uint32_t lane;
+
+        profileRing(std::uint32_t l) : events(PROFILE_RING_SIZE), lane(l) {}
+
+        void push(const char * name, std::int64_t start, std::int64_t end)
+        {
+            events[count % events.size()] = {name, start, end};
+            count++;
+        }
+};
+
+//owns every ring and hands them out to threads
+//the workers of a workerPool live for the whole run, so each keeps its ring and its lane in
+//the trace from its first scope to the end. A thread that does exit gives its ring back to a
+//free list, and the next new thread picks it up instead of adding a lane.
+class profiler
+{
+    private:
+        std::mutex m;
+        std::vector<std::unique_ptr<profileRing>> rings;
+        std::vector<profileRing *> freeRings;
+
+        std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+
+        //returns the ring to the pool when the owning thread exits
+        struct ringHandle
+        {
+            profileRing * ring = nullptr;
+
+            ~ringHandle()
+            {
+                if (ring) profiler::get().release(ring);
+            }
+        };
+
+        profileRing * acquire()
+        {
+            std::lock_guard<std::mutex> lock(m);
+            if (!freeRings.empty()) {
+                profileRing * r = freeRings.back();
+                freeRings.pop_back();
+                return r;
+            }
+            rings.push_back(std::make_unique<profileRing>(static_cast<std::uint32_t>(rings.size())));
+            return rings.back().get();
+        }
+
+        void release(profileRing * r)
+        {
+            std::lock_guard<std::mutex> lock(m);
+            freeRings.push_back(r);
+        }
+
+    public:
+        static profiler & get()
+        {
+            static profiler p;
+            return p;
+        }
+
+        std::int64_t now() const
+        {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - epoch).count();
+        }
+
+        //ring for the calling thread, taken from the pool on first use
+        profileRing & threadRing()
+        {
+            thread_local ringHandle handle;
+            if (!handle.ring) handle.ring = acquire();
+            return *handle.ring;
+        }
+
+        //writes all recorded spans as Chrome trace-event JSON
+        //call it while no other thread is recording, e.g. after the workers are joined
+        bool writeChromeTrace(const std::string & path)
+        {
+            std::ofstream out(path);
+            if (!out) return false;
+
+            std::lock_guard<std::mutex> lock(m);
+
+            out << "{\"traceEvents\":[\n";
+            bool first = true;
+
+            for (const auto & r : rings) {
+                if (!first) out << ",\n";
+                first = false;
+                out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << r->lane
+                    << ",\"args\":{\"name\":\"thread " << r->lane << "\"}}";
+
+                //oldest event first, skipping whatever has been overwritten
+                std::uint64_t size = r->events.size();
+                std::uint64_t begin = r->count > size ? r->count - size : 0;
+
+                for (std::uint64_t i = begin; i < r->count; i++) {
+                    const profileEvent & e = r->events[i % size];
+                    out << ",\n{\"name\":\"" << e.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << r->lane
+                        << ",\"ts\":" << e.start / 1000.0
+                        << ",\"dur\":" << (e.end - e.start) / 1000.0 << "}";
+                }
+            }
+
+            out << "\n]}\n";
+            return static_cast<bool>(out);
+        }
+};
+
+//records the time from construction to destruction
+class profileScope
+{
+    private:
+        const char * name;
+        std::int64_t start;
+
+#ifdef PROFILE_COUNTERS
+        perfSample startCounters;
+#endif
+
+#ifdef TRACK_ALLOCS
+        allocSample startAllocs;
+#endif
+
+    public:
+        explicit profileScope(const char * n) : name(n)
+        {
+#ifdef PROFILE_COUNTERS
+            startCounters = perfCounterGroup::thread().read();
+#endif
+#ifdef TRACK_ALLOCS
+            startAllocs = allocTracker::now();
+#endif
+            start = profiler::get().now();
+        }
+
+        ~profileScope()
+        {
+            profiler & p = profiler::get();
+            std::int64_t end = p.now();
+
+#ifdef TRACK_ALLOCS
+            //read before anything below can allocate
+            allocSample allocs = allocTracker::now() - startAllocs;
+#endif
+
+#ifdef PROFILE_COUNTERS
+            perfCounterGroup & group = perfCounterGroup::thread();
+            if (group.available()) frameStats::get().recordCounters(name, group.read() - startCounters, group);
+#endif
+
+            p.threadRing().push(name, start, end);
+            frameStats::get().record(name, static_cast<std::uint64_t>(end - start));
+
+#ifdef TRACK_ALLOCS
+            frameStats::get().recordAllocs(name, allocs);
+#endif
+        }
+
+        profileScope(const profileScope &) = delete;
+        profileScope & operator=(const profileScope &) = delete;
+};
+
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+
+#ifdef PROFILE
+#define PROFILE_SCOPE(name) profileScope PROFILE_CONCAT(profileScope_, __LINE__)(name)
+#define PROFILE_DUMP(path) profiler::get().writeChromeTrace(path)
+#define PROFILE_REPORT(path) frameStats::get().writeReport(std::string(path))
+#else
+#define PROFILE_SCOPE(name)
+#define PROFILE_DUMP(path)
+#define PROFILE_REPORT(path)
+#endif
@@ -0,0 +1,193 @@
+// Runtime scenario settings for the collision demos
+// Each demo's globals.h seeds a runConfig named config with its constants, and main() lets
+// command line flags and config files override it, so sweeps do not need a rebuild:
+//   ./test --rects 5000 --circles 0 --width 2560 --height 1440
+//   ./test --config scene.cfg --threads 4
+//   ./test --scenario clustered --seed 7
+//   ./test --kernels sse42
+// A config file holds one "key = value" per line with the same keys as the flags, # starts
+// a comment. Flags apply left to right, so flags after --config override the file.
+// Building with -DFIXED_CONFIG makes config constexpr, the compiler then folds every setting
+// into the code as before and the flags are rejected.
+
+#pragma once
+
+#include "cpuDispatch.h"
+#include "scenario.h"
+
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+enum broadphaseType
+{
+    BROADPHASE_BRUTEFORCE,
+    BROADPHASE_QUADTREE
+};
+
+struct runConfig
+{
+    int width;
+    int height;
+    int rectangleCount;
+    int circleCount;
+
+    //only the quadtree demo can switch, the others always test every pair
+    broadphaseType broadphase;
+
+    //worker threads for the threaded demos, 0 uses every hardware thread
+    int threads;
+
+    //quadtree limits, unsigned like the node level and object counts they are compared with
+    unsigned int maxLevel;
+    unsigned int maxObjects;
+
+    //frames the simulation may run ahead of rendering, 0 runs serially
+    int pipelineDepth;
+
+    //spawn preset and its seed, see common/scenario.h
+    scenarioType scenario;
+    int seed;
+
+    //snapshot files to build the scene from and to write once it is built, see common/snapshot.h
+    const char * loadPath;
+    const char * savePath;
+};
+
+
+//keeps a copy of a string setting alive for the rest of the run
+inline const char * keepConfigString(const std::string & s)
+{
+    static std::deque<std::string> strings;
+    strings.push_back(s);
+    return strings.back().c_str();
+}
+
+
+//parses value as a non negative int, false if it is not one or does not fit
+inline bool parseConfigInt(const std::string & value, int & out)
+{
+    char * end = nullptr;
+    errno = 0;
+    long v = std::strtol(value.c_str(), &end, 10);
+    if (value.empty() || *end != '\0' || errno == ERANGE || v < 0 || v > INT_MAX) return false;
+    out = static_cast<int>(v);
+    return true;
+}
+
+//the same for unsigned settings, negative values are rejected
+inline bool parseConfigInt(const std::string & value, unsigned int & out)
+{
+    int v = 0;
+    if (!parseConfigInt(value, v)) return false;
+    out = static_cast<unsigned int>(v);
+    return true;
+}
+
+
+//sets one setting by name, false if the key is unknown or the value is invalid
+//settings a demo has no use for are accepted and ignored
+inline bool applyRunConfig(const std::string & key, const std::string & value, runConfig & cfg)
+{
+    if (key == "width") return parseConfigInt(value, cfg.width) && cfg.width > 0;
+    if (key == "height") return parseConfigInt(value, cfg.height) && cfg.height > 0;
+    //the scene holds both counts together, so their sum has to fit an int as well
+    if (key == "rects") return parseConfigInt(value, cfg.rectangleCount) && cfg.rectangleCount <= INT_MAX - cfg.circleCount;
+    if (key == "circles") return parseConfigInt(value, cfg.circleCount) && cfg.circleCount <= INT_MAX - cfg.rectangleCount;
+    if (key == "threads") return parseConfigInt(value, cfg.threads);
+    if (key == "max-level") return parseConfigInt(value, cfg.maxLevel);
+    if (key == "max-objects") return parseConfigInt(value, cfg.maxObjects) && cfg.maxObjects > 0;
+    if (key == "pipeline") return parseConfigInt(value, cfg.pipelineDepth);
+    if (key == "seed") return parseConfigInt(value, cfg.seed);
+    if (key == "scenario") return scenarioFromName(value, cfg.scenario);
+    if (key == "load") return !value.empty() && (cfg.loadPath = keepConfigString(value));
+    if (key == "save") return !value.empty() && (cfg.savePath = keepConfigString(value));
+
+    //process wide rather than part of cfg, the vector kernels are shared by every system
+    if (key == "kernels") {
+        cpuLevel level;
+        if (!cpuLevelFromName(value, level)) return false;
+        forceKernelLevel(level);
+        return true;
+    }
+    if (key == "broadphase") {
+        if (value == "bruteforce") cfg.broadphase = BROADPHASE_BRUTEFORCE;
+        else if (value == "quadtree") cfg.broadphase = BROADPHASE_QUADTREE;
+        else return false;
+        return true;
+    }
+    return false;
+}
+
+
+//applies every "key = value" line of a config file
+inline bool loadRunConfig(const std::string & path, runConfig & cfg)
+{
+    std::ifstream in(path);
+    if (!in) {
+        std::cerr << "could not open config file " << path << "\n";
+        return false;
+    }
+
+    auto trim = [](std::string s) {
+        size_t b = s.find_first_not_of(" \t\r");
+        size_t e = s.find_last_not_of(" \t\r");
+        return b == std::string::npos ? std::string() : s.substr(b, e - b + 1);
+    };
+
+    std::string line;
+    int lineNo = 0;
+    while (std::getline(in, line)) {
+        lineNo++;
+        line = trim(line.substr(0, line.find('#')));
+        if (line.empty()) continue;
+
+        size_t eq = line.find('=');
+        std::string key = eq == std::string::npos ? line : trim(line.substr(0, eq));
+        std::string value = eq == std::string::npos ? "" : trim(line.substr(eq + 1));
+        if (!applyRunConfig(key, value, cfg)) {
+            std::cerr << path << ":" << lineNo << ": invalid setting \"" << line << "\"\n";
+            return false;
+        }
+    }
+    return true;
+}
+
+
+inline void printRunConfigUsage(const char * exe)
+{
+    std::cerr << "usage: " << exe << " [--config file] [--width N] [--height N] [--rects N] [--circles N]\n"
+              << "       [--broadphase bruteforce|quadtree] [--threads N] [--max-level N] [--max-objects N]\n"
+              << "       [--pipeline N] [--scenario uniform|clustered|corner|mixed|fast] [--seed N]\n"
+              << "       [--load snapshot] [--save snapshot] [--kernels scalar|sse42|avx2|avx512]\n";
+}
+
+
+//applies the command line on top of cfg, false (after printing why) if it could not be parsed
+inline bool parseRunConfig(int argc, char ** argv, runConfig & cfg)
+{
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--help" || arg == "-h" || arg.rfind("--", 0) != 0 || i + 1 >= argc) {
+            printRunConfigUsage(argv[0]);
+            return false;
+        }
+
+        std::string key = arg.substr(2);
+        std::string value = argv[++i];
+
+        if (key == "config") {
+            if (!loadRunConfig(value, cfg)) return false;
+        }
+        else if (!applyRunConfig(key, value, cfg)) {
+            std::cerr << "invalid argument " << arg << " " << value << "\n";
+            printRunConfigUsage(argv[0]);
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,330 @@
+// Deterministic scenario generator shared by the demos and the benchmarks
+// The same preset, seed and world size always give the same spawns on a given build. The
+// generator uses its own PRNG and distributions instead of rand() or <random>, whose
+// sequences differ between standard libraries. uniform, corner and fast only use integer
+// and basic float arithmetic, so their spawns are also the same on every platform. clustered
+// and mixed go through std::log, std::exp, std::cos and std::sqrt, whose last bits can differ
+// between math libraries, so another platform may place them slightly differently.
+//
+// Presets:
+//   uniform    5-20px rectangles and circles of radius 5-20 spread over the whole world, the
+//              sizes of the original demo scene
+//   clustered  the same shapes packed around a handful of gaussian hot spots
+//   corner     everything stacked into the top left corner, worst case for the quadtree
+//   mixed      boxes from 3 to 80px, log-uniform so small boxes still dominate
+//   fast       the uniform scene with six times the maximum speed
+//
+// The generator only describes the spawns, each demo turns them into its own components.
+// Non overlapping placement checks candidates against a uniform grid of the boxes placed so
+// far, so large scenes place in roughly linear time. Scenes whose boxes add up to more than
+// the free area are rejected up front.
+
+#pragma once
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+//PCG32 (O'Neill, pcg-random.org), 64 bit state and 32 bit output
+class pcg32
+{
+    private:
+        std::uint64_t state = 0;
+        std::uint64_t inc;
+
+    public:
+        explicit pcg32(std::uint64_t seed, std::uint64_t stream = 54) : inc((stream << 1) | 1)
+        {
+            next();
+            state += seed;
+            next();
+        }
+
+        std::uint32_t next()
+        {
+            std::uint64_t old = state;
+            state = old * 6364136223846793005ULL + inc;
+            std::uint32_t xorshifted = static_cast<std::uint32_t>(((old >> 18) ^ old) >> 27);
+            std::uint32_t rot = static_cast<std::uint32_t>(old >> 59);
+            return (xorshifted >> rot) | (xorshifted << ((32 - rot) & 31));
+        }
+
+        //uniform in [min, max), built from the top 24 bits so every float step is reachable
+        float uniform(float min, float max)
+        {
+            return min + (next() >> 8) * (1.0f / 16777216.0f) * (max - min);
+        }
+
+        //standard normal, Box-Muller
+        float normal()
+        {
+            float u1 = uniform(1e-7f, 1.0f);
+            float u2 = uniform(0.0f, 1.0f);
+            return std::sqrt(-2.0f * std::log(u1)) * std::cos(6.2831853f * u2);
+        }
+};
+
+
+enum scenarioType
+{
+    SCENARIO_UNIFORM,
+    SCENARIO_CLUSTERED,
+    SCENARIO_CORNER,
+    SCENARIO_MIXED,
+    SCENARIO_FAST,
+    SCENARIO_COUNT
+};
+
+inline const char * scenarioName(scenarioType t)
+{
+    static const char * names[SCENARIO_COUNT] = {"uniform", "clustered", "corner", "mixed", "fast"};
+    return t >= 0 && t < SCENARIO_COUNT ? names[t] : "unknown";
+}
+
+//false if name is not a preset
+inline bool scenarioFromName(const std::string & name, scenarioType & out)
+{
+    for (int i = 0; i < SCENARIO_COUNT; i++) {
+        if (name == scenarioName(static_cast<scenarioType>(i))) {
+            out = static_cast<scenarioType>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+
+enum spawnShape
+{
+    SPAWN_RECT,
+    SPAWN_CIRCLE
+};
+
+//one entity to create, x and y are the top left of its w by h box
+//circles have w == h == 2 * radius
+struct spawnDesc
+{
+    spawnShape shape = SPAWN_RECT;
+    float x = 0.0f;
+    float y = 0.0f;
+    int w = 0;
+    int h = 0;
+    float vx = 0.0f;
+    float vy = 0.0f;
+    int r = 255;
+    int g = 255;
+    int b = 255;
+};
+
+//uniform grid over the boxes placed so far, answers overlap queries for new candidates
+//cells are at least as large as the largest box, so every box touches at most four cells
+class placementGrid
+{
+    private:
+        const std::vector<spawnDesc> & boxes;
+        float cellSize;
+        int cols;
+        int rows;
+
+        //indices into boxes of everything touching each cell
+        std::vector<std::vector<int>> cells;
+
+        //cell range covered by a box, clamped to the grid
+        void range(float x, float y, int w, int h, int & c0, int & r0, int & c1, int & r1) const
+        {
+            c0 = std::clamp(static_cast<int>(x / cellSize), 0, cols - 1);
+            r0 = std::clamp(static_cast<int>(y / cellSize), 0, rows - 1);
+            c1 = std::clamp(static_cast<int>((x + w) / cellSize), 0, cols - 1);
+            r1 = std::clamp(static_cast<int>((y + h) / cellSize), 0, rows - 1);
+        }
+
+    public:
+        placementGrid(int width, int height, int maxBox, const std::vector<spawnDesc> & placed)
+            : boxes(placed), cellSize(static_cast<float>(std::max(maxBox, 1)))
+        {
+            cols = static_cast<int>(width / cellSize) + 1;
+            rows = static_cast<int>(height / cellSize) + 1;
+            cells.resize(static_cast<size_t>(cols) * rows);
+        }
+
+        bool overlaps(float x, float y, int w, int h) const
+        {
+            int c0, r0, c1, r1;
+            range(x, y, w, h, c0, r0, c1, r1);
+            for (int r = r0; r <= r1; r++) {
+                for (int c = c0; c <= c1; c++) {
+                    for (int i : cells[static_cast<size_t>(r) * cols + c]) {
+                        const spawnDesc & o = boxes[i];
+                        if (x < o.x + o.w && x + w > o.x && y < o.y + o.h && y + h > o.y) return true;
+                    }
+                }
+            }
+            return false;
+        }
+
+        //registers boxes[index] in every cell it touches
+        void insert(int index)
+        {
+            const spawnDesc & b = boxes[index];
+            int c0, r0, c1, r1;
+            range(b.x, b.y, b.w, b.h, c0, r0, c1, r1);
+            for (int r = r0; r <= r1; r++) {
+                for (int c = c0; c <= c1; c++) cells[static_cast<size_t>(r) * cols + c].push_back(index);
+            }
+        }
+};
+
+
+struct scenarioParams
+{
+    scenarioType type = SCENARIO_UNIFORM;
+    std::uint32_t seed = 1;
+
+    int width = 0;
+    int height = 0;
+    int rectangles = 0;
+    int circles = 0;
+
+    //velocities are drawn from [-maxSpeed, maxSpeed] on each axis
+    float maxSpeed = 2.0f;
+
+    //border kept free for the walls
+    int margin = 10;
+
+    //no two spawns overlap, the benchmarks turn this off for counts the screen cannot hold
+    bool separate = true;
+};
+
+
+//fills out with the spawns of a scenario, rectangles first then circles
+//returns false if separate was asked for and some entities found no free spot, out then
+//holds the ones that did. Every entity gets a bounded number of attempts, so even a jammed
+//scene finishes in linear time. If the boxes cannot fit even when perfectly packed it returns
+//false straight away with out empty, as it does for negative counts or counts whose sum does not
+//fit an int.
+inline bool generateScenario(const scenarioParams & p, std::vector<spawnDesc> & out)
+{
+    pcg32 rng(p.seed);
+    out.clear();
+
+    //counts that are negative or add up to more than an int are never placeable
+    std::int64_t count = static_cast<std::int64_t>(p.rectangles) + p.circles;
+    if (p.rectangles < 0 || p.circles < 0 || count > INT_MAX) return false;
+    out.reserve(static_cast<std::size_t>(count));
+
+    const float minX = static_cast<float>(p.margin);
+    const float minY = static_cast<float>(p.margin);
+    const float maxX = static_cast<float>(p.width - p.margin);
+    const float maxY = static_cast<float>(p.height - p.margin);
+
+    //area a typical 5-20px box needs with room to spare, random placement jams well before
+    //the boxes cover the whole area. A circle's box is twice as wide, so it needs four times as much
+    int total = static_cast<int>(count);
+    const float roomPerBox = 156.0f * 3.0f;
+    const float room = roomPerBox * (static_cast<float>(p.rectangles) + 4.0f * static_cast<float>(p.circles));
+
+    //region the corner preset packs into
+    float cornerSide = std::sqrt(room);
+    float cornerMaxX = std::min(maxX, minX + cornerSide);
+    float cornerMaxY = std::min(maxY, minY + cornerSide);
+
+    //hot spots of the clustered preset
+    struct cluster { float x, y; };
+    std::vector<cluster> clusters;
+    //spread grows with the count so each hot spot has room for its share of the boxes
+    float spread = std::max(std::min(p.width, p.height) / 20.0f, std::sqrt(room / 8.0f / 3.14159f) / 2.0f);
+    if (p.type == SCENARIO_CLUSTERED) {
+        for (int i = 0; i < 8; i++) clusters.push_back({rng.uniform(minX, maxX), rng.uniform(minY, maxY)});
+    }
+
+    auto size = [&]() {
+        if (p.type == SCENARIO_MIXED) return static_cast<int>(std::exp(rng.uniform(std::log(3.0f), std::log(80.0f))));
+        return static_cast<int>(rng.uniform(5, 20));
+    };
+
+    //top left corner for a w by h box, always inside the margins
+    auto position = [&](int w, int h, float & x, float & y) {
+        float hiX = std::max(minX, maxX - w);
+        float hiY = std::max(minY, maxY - h);
+        switch (p.type) {
+            case SCENARIO_CLUSTERED: {
+                const cluster & c = clusters[rng.next() % clusters.size()];
+                x = c.x + rng.normal() * spread;
+                y = c.y + rng.normal() * spread;
+                break;
+            }
+            case SCENARIO_CORNER:
+                x = rng.uniform(minX, std::max(minX, cornerMaxX - w));
+                y = rng.uniform(minY, std::max(minY, cornerMaxY - h));
+                break;
+            default:
+                x = rng.uniform(minX, hiX);
+                y = rng.uniform(minY, hiY);
+                break;
+        }
+        x = std::clamp(x, minX, hiX);
+        y = std::clamp(y, minY, hiY);
+    };
+
+    //sizes are drawn first so an impossible density is caught before placing anything
+    std::vector<std::pair<int, int>> sizes(total);
+    double boxArea = 0.0;
+    int maxBox = 1;
+    for (int i = 0; i < total; i++) {
+        if (i < p.rectangles) {
+            sizes[i].first = size();
+            sizes[i].second = size();
+        } else {
+            //a box around a circle of radius size(), mixed keeps the drawn size as the box side
+            int side = p.type == SCENARIO_MIXED ? size() / 2 * 2 : 2 * size();
+            sizes[i].first = sizes[i].second = side;
+        }
+        boxArea += static_cast<double>(sizes[i].first) * sizes[i].second;
+        maxBox = std::max({maxBox, sizes[i].first, sizes[i].second});
+    }
+
+    if (p.separate) {
+        bool corner = p.type == SCENARIO_CORNER;
+        double freeArea = static_cast<double>((corner ? cornerMaxX : maxX) - minX) * ((corner ? cornerMaxY : maxY) - minY);
+        if (boxArea > freeArea) return false;
+    }
+
+    placementGrid grid(p.width, p.height, maxBox, out);
+
+    float speed = p.type == SCENARIO_FAST ? p.maxSpeed * 6.0f : p.maxSpeed;
+
+    //attempts per entity before the scene counts as too dense
+    constexpr int maxAttempts = 1000;
+    bool placedAll = true;
+
+    for (int i = 0; i < total; i++) {
+        spawnDesc d;
+        d.shape = i < p.rectangles ? SPAWN_RECT : SPAWN_CIRCLE;
+        d.w = sizes[i].first;
+        d.h = sizes[i].second;
+
+        int attempt = 0;
+        do {
+            position(d.w, d.h, d.x, d.y);
+        } while (p.separate && grid.overlaps(d.x, d.y, d.w, d.h) && ++attempt < maxAttempts);
+
+        d.vx = rng.uniform(-speed, speed);
+        d.vy = rng.uniform(-speed, speed);
+        d.r = static_cast<int>(rng.uniform(0, 256));
+        d.g = static_cast<int>(rng.uniform(0, 256));
+        d.b = static_cast<int>(rng.uniform(0, 256));
+
+        if (attempt == maxAttempts) {
+            placedAll = false;
+            continue;
+        }
+        out.push_back(d);
+        if (p.separate) grid.insert(static_cast<int>(out.size()) - 1);
+    }
+
+    return placedAll;
+}
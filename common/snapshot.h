@@ -0,0 +1,311 @@
+// Binary world snapshots
+// Include after the demo's components.h, a snapshot covers every type in its ComponentList.
+//
+// saveSnapshot writes the entity sets of a scene and every component map as dense arrays of
+// whole components, loadSnapshot reads them back into the same sets and maps. Every array is
+// one write and one read of raw bytes, then loadSnapshot adds each array in bulk, which for
+// structure of arrays types writes every field array in one pass. Large scenes load without
+// building them again:
+//   ./quadTree --rects 100000 --width 8000 --height 6000 --save scene.snap
+//   ./quadTree --load scene.snap
+//
+// Layout, host byte order, every array starts on a 64 byte boundary:
+//   snapshotHeader
+//   per entity table:    uint64 count, count entity ids
+//   per component type:  snapshotTypeHeader, count entity ids, count components
+// Component arrays are sorted by entity id, so mappedSnapshot.h can look components up in
+// the file directly.
+// Only trivially copyable components are stored, other types are written with a count of
+// zero and come back empty. So are types that declare static constexpr bool PROCESS_LOCAL =
+// true, whose data, like an interned name id, means nothing to another run.
+
+#pragma once
+
+#include "entitySet.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <typeinfo>
+#include <vector>
+
+constexpr std::uint32_t SNAPSHOT_VERSION(2);
+constexpr std::size_t SNAPSHOT_ALIGN(64);
+
+struct snapshotHeader
+{
+    char magic[4] = {'L', 'E', 'C', 'S'};
+    std::uint32_t version = SNAPSHOT_VERSION;
+    std::uint32_t tableCount = 0;
+    std::uint32_t typeCount = 0;
+};
+
+struct snapshotTypeHeader
+{
+    //FNV-1a of the type name, with size it catches snapshots saved with a different
+    //component set
+    std::uint32_t typeHash = 0;
+    std::uint32_t size = 0;
+    std::uint64_t count = 0;
+};
+
+
+template <typename T>
+std::uint32_t snapshotTypeHash()
+{
+    std::uint32_t h = 2166136261u;
+    for (const char * c = typeid(T).name(); *c; c++) {
+        h ^= static_cast<unsigned char>(*c);
+        h *= 16777619u;
+    }
+    return h;
+}
+
+template <typename T, typename = void>
+struct processLocal : std::false_type {};
+
+template <typename T>
+struct processLocal<T, std::void_t<decltype(T::PROCESS_LOCAL)>> : std::bool_constant<T::PROCESS_LOCAL> {};
+
+//true for the component types whose arrays a snapshot holds
+template <typename T>
+constexpr bool snapshotStored = std::is_trivially_copyable_v<T> && !processLocal<T>::value;
+
+//bytes needed to pad offset up to the next array boundary
+inline std::size_t snapshotPadding(std::size_t offset)
+{
+    return (SNAPSHOT_ALIGN - offset % SNAPSHOT_ALIGN) % SNAPSHOT_ALIGN;
+}
+
+
+//writes raw arrays and keeps them aligned
+class snapshotWriter
+{
+    private:
+        std::ofstream out;
+        std::size_t offset = 0;
+
+    public:
+        explicit snapshotWriter(const std::string & path) : out(path, std::ios::binary) {}
+
+        bool ok() const { return static_cast<bool>(out); }
+
+        void write(const void * data, std::size_t bytes)
+        {
+            out.write(static_cast<const char *>(data), bytes);
+            offset += bytes;
+        }
+
+        void align()
+        {
+            static const char zeros[SNAPSHOT_ALIGN] = {};
+            write(zeros, snapshotPadding(offset));
+        }
+};
+
+//reads raw arrays written by snapshotWriter
+class snapshotReader
+{
+    private:
+        std::ifstream in;
+        std::size_t offset = 0;
+        std::size_t length = 0;
+
+    public:
+        explicit snapshotReader(const std::string & path) : in(path, std::ios::binary)
+        {
+            if (!in) return;
+            in.seekg(0, std::ios::end);
+            length = static_cast<std::size_t>(in.tellg());
+            in.seekg(0, std::ios::beg);
+        }
+
+        bool ok() const { return static_cast<bool>(in); }
+
+        //true if count items of itemBytes each fit in what is left of the file, checked
+        //before sizing anything from a count the file claims
+        bool fits(std::uint64_t count, std::size_t itemBytes) const
+        {
+            std::size_t left = offset < length ? length - offset : 0;
+            return itemBytes == 0 || count <= left / itemBytes;
+        }
+
+        bool read(void * data, std::size_t bytes)
+        {
+            in.read(static_cast<char *>(data), bytes);
+            offset += bytes;
+            return static_cast<bool>(in);
+        }
+
+        bool align()
+        {
+            char skip[SNAPSHOT_ALIGN];
+            return read(skip, snapshotPadding(offset));
+        }
+};
+
+
+//first id not used by any entity in the tables, for continuing to spawn after a load
+inline int nextFreeEntityId(const std::vector<const entitySet *> & tables)
+{
+    int next = 0;
+    for (const auto * t : tables) {
+        for (const auto & e : *t) {
+            if (e.isValid()) next = std::max(next, static_cast<int>(e.entity_id) + 1);
+        }
+    }
+    return next;
+}
+
+
+//saves the entity sets and all components, false if the file could not be written
+inline bool saveSnapshot(const std::string & path, const componentManager & cm,
+                         const std::vector<const entitySet *> & tables)
+{
+    snapshotWriter w(path);
+    if (!w.ok()) {
+        std::cerr << "could not write snapshot " << path << "\n";
+        return false;
+    }
+
+    snapshotHeader header;
+    header.tableCount = static_cast<std::uint32_t>(tables.size());
+    header.typeCount = static_cast<std::uint32_t>(std::tuple_size_v<ComponentList>);
+    w.write(&header, sizeof(header));
+
+    for (const auto * t : tables) {
+        std::uint64_t count = t->size();
+        w.write(&count, sizeof(count));
+        w.align();
+        w.write(t->data(), count * sizeof(entity));
+        w.align();
+    }
+
+    //gathers each map into dense id and component arrays sorted by id
+    std::apply([&](auto... type) {
+        ([&] {
+            using T = decltype(type);
+            snapshotTypeHeader th;
+            th.typeHash = snapshotTypeHash<T>();
+            th.size = sizeof(T);
+
+            std::vector<entity> ids;
+            std::vector<T> comps;
+            if constexpr (soaLayout<T>::enabled) {
+                //structure of arrays storage is indexed by id, walking it is already sorted
+                const auto & storage = cm.getMap<T>();
+                ids.reserve(storage.size());
+                comps.reserve(storage.size());
+                for (std::uint32_t id = 0; id < storage.slots(); id++) {
+                    if (!storage.liveMask()[id]) continue;
+                    ids.push_back(entity(id));
+                    comps.push_back(storage.load(id));
+                }
+                th.count = storage.size();
+            }
+            else if constexpr (snapshotStored<T>) {
+                const auto & map = cm.getMap<T>();
+                std::vector<const std::pair<const entity, T> *> sorted;
+                sorted.reserve(map.size());
+                //entries of entities released to an entity pool are kept but hidden, skip them
+                for (const auto & kv : map) {
+                    if (cm.hasComponent<T>(kv.first)) sorted.push_back(&kv);
+                }
+                std::sort(sorted.begin(), sorted.end(), [](const auto * a, const auto * b) {
+                    return a->first.entity_id < b->first.entity_id;
+                });
+
+                ids.reserve(map.size());
+                comps.reserve(map.size());
+                for (const auto * kv : sorted) {
+                    ids.push_back(kv->first);
+                    comps.push_back(kv->second);
+                }
+                th.count = sorted.size();
+            }
+
+            w.write(&th, sizeof(th));
+            w.align();
+            w.write(ids.data(), ids.size() * sizeof(entity));
+            w.align();
+            if constexpr (snapshotStored<T>) w.write(comps.data(), comps.size() * sizeof(T));
+            w.align();
+        }(), ...);
+    }, ComponentList{});
+
+    if (!w.ok()) {
+        std::cerr << "failed writing snapshot " << path << "\n";
+        return false;
+    }
+    return true;
+}
+
+
+//replaces the current world with a snapshot, every component map is cleared first
+//tables must hold as many sets as the snapshot was saved with
+//returns false if the file is missing, truncated or from a different component set
+inline bool loadSnapshot(const std::string & path, const componentManager & cm,
+                         const std::vector<entitySet *> & tables)
+{
+    snapshotReader r(path);
+    snapshotHeader header;
+    if (!r.ok() || !r.read(&header, sizeof(header))) {
+        std::cerr << "could not read snapshot " << path << "\n";
+        return false;
+    }
+
+    if (std::memcmp(header.magic, "LECS", 4) != 0 || header.version != SNAPSHOT_VERSION ||
+        header.tableCount != tables.size() || header.typeCount != std::tuple_size_v<ComponentList>) {
+        std::cerr << path << " is not a snapshot of this scene layout\n";
+        return false;
+    }
+
+    for (auto * t : tables) {
+        std::uint64_t count = 0;
+        if (!r.read(&count, sizeof(count)) || !r.align() || !r.fits(count, sizeof(entity))) {
+            std::cerr << path << " is truncated\n";
+            return false;
+        }
+        std::vector<entity> ids(count);
+        if (!r.read(ids.data(), count * sizeof(entity)) || !r.align()) return false;
+        t->assign(ids.begin(), ids.end());
+    }
+
+    cm.clearAllComponents();
+
+    bool ok = true;
+    std::apply([&](auto... type) {
+        ([&] {
+            using T = decltype(type);
+            if (!ok) return;
+
+            snapshotTypeHeader th;
+            ok = r.read(&th, sizeof(th)) && r.align() &&
+                 th.typeHash == snapshotTypeHash<T>() && th.size == sizeof(T) &&
+                 r.fits(th.count, sizeof(entity) + (snapshotStored<T> ? sizeof(T) : 0));
+            if (!ok) return;
+
+            std::vector<entity> ids(th.count);
+            ok = r.read(ids.data(), th.count * sizeof(entity)) && r.align();
+            if (!ok) return;
+
+            if constexpr (snapshotStored<T>) {
+                //default constructed then overwritten in one read
+                std::vector<T> comps(th.count);
+                ok = r.read(comps.data(), th.count * sizeof(T)) && r.align();
+                if (!ok) return;
+
+                cm.addComponents(ids.data(), comps.data(), ids.size());
+            }
+            else ok = th.count == 0 && r.align();
+        }(), ...);
+    }, ComponentList{});
+
+    if (!ok) std::cerr << path << " is truncated or was saved with different components\n";
+    return ok;
+}
@@ -0,0 +1,385 @@
+// Structure of arrays storage for hot numeric components
+// Include after the demo's entity.h, components.h picks the types that use it.
+//
+// A component type opts in with an soaLayout specialization naming its fields and a
+// reference struct with one reference member per field, in the same order:
+//
+//   struct positionRef { float & px; float & py; };
+//   template <> struct soaLayout<positionComponent>
+//   {
+//       static constexpr bool enabled = true;
+//       using ref = positionRef;
+//       static constexpr auto fields = std::make_tuple(&positionComponent::px, &positionComponent::py);
+//   };
+//
+// Every field then lives in its own 64 byte aligned array indexed by entity id, so px of
+// entity i sits at px[i] next to px[i + 1], and position i lines up with velocity i. That is
+// the layout the batched movement and collision kernels load straight into vector registers.
+// A live array marks the ids that have the component.
+//
+// componentManager::getComponent returns an soaPtr for these types. It behaves like the
+// component pointer the systems used before, p->px reads and writes the px array, so system
+// code only has to spell its pointer type componentPtr<T>. An soaPtr holds the storage and the
+// id rather than an address, so it stays valid when the arrays grow.
+// Ids are expected to be small and dense, as handed out by the demos' counters.
+
+#pragma once
+
+#include "nodePool.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+
+constexpr std::size_t SOA_ALIGN(64);
+
+//bytes allocated past the last element of every array, so a kernel that gathers 32 bits from
+//a 16 bit array, like the overlap kernels do with hitbox extents, stays inside the allocation
+constexpr std::size_t SOA_SLACK(sizeof(std::uint32_t));
+
+
+//types stay in unordered_map storage unless they specialize this
+template <typename T>
+struct soaLayout
+{
+    static constexpr bool enabled = false;
+};
+
+
+//growable array of trivially copyable elements on an SOA_ALIGN boundary, followed by SOA_SLACK
+//bytes, unlike std::vector it also stores bool as one byte per element
+template <typename T>
+class alignedArray
+{
+    static_assert(std::is_trivially_copyable_v<T>, "alignedArray holds plain data only");
+
+    private:
+        T * items = nullptr;
+        std::size_t count = 0;
+        std::size_t cap = 0;
+
+    public:
+        alignedArray() = default;
+
+        alignedArray(const alignedArray & other)
+        {
+            *this = other;
+        }
+
+        alignedArray & operator=(const alignedArray & other)
+        {
+            if (this == &other) return *this;
+            count = 0;
+            reserve(other.count);
+            if (other.count) std::memcpy(items, other.items, other.count * sizeof(T));
+            count = other.count;
+            return *this;
+        }
+
+        ~alignedArray()
+        {
+            ::operator delete(items, std::align_val_t(SOA_ALIGN));
+        }
+
+        void reserve(std::size_t n)
+        {
+            if (n <= cap) return;
+            T * grown = static_cast<T *>(::operator new(n * sizeof(T) + SOA_SLACK, std::align_val_t(SOA_ALIGN)));
+            if (count) std::memcpy(grown, items, count * sizeof(T));
+            ::operator delete(items, std::align_val_t(SOA_ALIGN));
+            items = grown;
+            cap = n;
+        }
+
+        //new elements are set to value, capacity at least doubles so growing id by id stays linear
+        void resize(std::size_t n, const T & value = T())
+        {
+            if (n > cap) reserve(n > cap * 2 ? n : cap * 2);
+            for (std::size_t i = count; i < n; i++) items[i] = value;
+            count = n;
+        }
+
+        void clear() { count = 0; }
+
+        std::size_t size() const { return count; }
+        T * data() { return items; }
+        const T * data() const { return items; }
+        T & operator[](std::size_t i) { return items[i]; }
+        const T & operator[](std::size_t i) const { return items[i]; }
+};
+
+
+template <typename T>
+class soaStorage;
+
+//pointer-like handle to a component in soaStorage, see the top of the file
+template <typename T>
+class soaPtr
+{
+    public:
+        using ref = typename soaLayout<T>::ref;
+
+    private:
+        soaStorage<T> * storage = nullptr;
+        std::uint32_t id = 0;
+
+        //keeps the reference struct alive for the duration of a -> expression
+        struct arrow
+        {
+            ref r;
+            ref * operator->() { return &r; }
+        };
+
+    public:
+        soaPtr() = default;
+        soaPtr(std::nullptr_t) {}
+        soaPtr(soaStorage<T> * s, std::uint32_t i) : storage(s), id(i) {}
+
+        arrow operator->() const { return arrow{storage->at(id)}; }
+        ref operator*() const { return storage->at(id); }
+
+        explicit operator bool() const { return storage != nullptr; }
+        bool operator==(std::nullptr_t) const { return storage == nullptr; }
+        bool operator!=(std::nullptr_t) const { return storage != nullptr; }
+
+        //copy of the component the handle points at
+        T load() const { return storage->load(id); }
+};
+
+
+template <typename T>
+class soaStorage
+{
+    private:
+        template <typename M>
+        struct fieldOf;
+
+        template <typename F>
+        struct fieldOf<F T::*>
+        {
+            using type = F;
+        };
+
+        static constexpr auto fields = soaLayout<T>::fields;
+        static constexpr std::size_t FIELD_COUNT = std::tuple_size_v<decltype(fields)>;
+
+        template <std::size_t I>
+        using fieldType = typename fieldOf<std::remove_cv_t<std::tuple_element_t<I, decltype(fields)>>>::type;
+
+        template <std::size_t... I>
+        static auto makeArrays(std::index_sequence<I...>) -> std::tuple<alignedArray<fieldType<I>>...>;
+
+        decltype(makeArrays(std::make_index_sequence<FIELD_COUNT>{})) arrays;
+        alignedArray<std::uint8_t> live;
+        std::size_t count = 0;
+
+        template <std::size_t... I>
+        void store(std::uint32_t id, const T & c, std::index_sequence<I...>)
+        {
+            (..., (std::get<I>(arrays)[id] = c.*std::get<I>(fields)));
+        }
+
+        template <std::size_t... I>
+        void fillFields(std::uint32_t first, std::size_t n, const T & c, std::index_sequence<I...>)
+        {
+            (..., std::fill_n(std::get<I>(arrays).data() + first, n, c.*std::get<I>(fields)));
+        }
+
+        //field I of every component, written to the slots of their ids in one pass
+        template <std::size_t I>
+        void assignField(const entity * ids, const T * comps, std::size_t n)
+        {
+            fieldType<I> * a = std::get<I>(arrays).data();
+            for (std::size_t i = 0; i < n; i++) {
+                if (ids[i].isValid()) a[ids[i].entity_id] = comps[i].*std::get<I>(fields);
+            }
+        }
+
+        template <std::size_t... I>
+        void assignFields(const entity * ids, const T * comps, std::size_t n, std::index_sequence<I...>)
+        {
+            (..., assignField<I>(ids, comps, n));
+        }
+
+        template <std::size_t... I>
+        T read(std::uint32_t id, std::index_sequence<I...>) const
+        {
+            T c;
+            (..., (c.*std::get<I>(fields) = std::get<I>(arrays)[id]));
+            return c;
+        }
+
+        template <std::size_t... I>
+        typename soaLayout<T>::ref reference(std::uint32_t id, std::index_sequence<I...>)
+        {
+            return {std::get<I>(arrays)[id]...};
+        }
+
+        //grows every array to cover id, new slots are not live
+        void grow(std::uint32_t id)
+        {
+            if (id < live.size()) return;
+            std::size_t n = static_cast<std::size_t>(id) + 1;
+            std::apply([&](auto &... a) { (..., a.resize(n)); }, arrays);
+            live.resize(n, 0);
+        }
+
+    public:
+        using pointer = soaPtr<T>;
+
+        //one live component as seen when iterating, first is the entity and second the
+        //reference struct, like the pairs of an unordered_map
+        struct entry
+        {
+            entity first;
+            typename soaLayout<T>::ref second;
+        };
+
+        class iterator
+        {
+            private:
+                soaStorage * s;
+                std::uint32_t id;
+
+                void skip()
+                {
+                    while (id < s->live.size() && !s->live[id]) id++;
+                }
+
+            public:
+                iterator(soaStorage * storage, std::uint32_t start) : s(storage), id(start) { skip(); }
+
+                entry operator*() const { return {entity(id), s->at(id)}; }
+                iterator & operator++() { id++; skip(); return *this; }
+                bool operator!=(const iterator & other) const { return id != other.id; }
+                bool operator==(const iterator & other) const { return id == other.id; }
+        };
+
+        //same spelling as unordered_map so the manager can treat both storages alike
+        void insert_or_assign(const entity & e, const T & c)
+        {
+            if (!e.isValid()) return;
+            grow(e.entity_id);
+            store(e.entity_id, c, std::make_index_sequence<FIELD_COUNT>{});
+            if (!live[e.entity_id]) count++;
+            live[e.entity_id] = 1;
+        }
+
+        //stores c for the n ids from first on, growing the arrays once for all of them
+        void fill(std::uint32_t first, std::size_t n, const T & c)
+        {
+            if (n == 0) return;
+            grow(static_cast<std::uint32_t>(first + n - 1));
+            fillFields(first, n, c, std::make_index_sequence<FIELD_COUNT>{});
+            for (std::size_t i = first; i < first + n; i++) {
+                count += !live[i];
+                live[i] = 1;
+            }
+        }
+
+        //stores comps[i] for ids[i], growing the arrays once for all of them
+        //each field array is written in its own pass, invalid ids are skipped
+        void assign(const entity * ids, const T * comps, std::size_t n)
+        {
+            std::size_t end = 0;
+            for (std::size_t i = 0; i < n; i++) {
+                if (ids[i].isValid()) end = std::max(end, static_cast<std::size_t>(ids[i].entity_id) + 1);
+            }
+            if (end == 0) return;
+            growSlots(end);
+            assignFields(ids, comps, n, std::make_index_sequence<FIELD_COUNT>{});
+            for (std::size_t i = 0; i < n; i++) {
+                if (!ids[i].isValid()) continue;
+                count += !live[ids[i].entity_id];
+                live[ids[i].entity_id] = 1;
+            }
+        }
+
+        std::size_t erase(const entity & e)
+        {
+            if (!contains(e)) return 0;
+            live[e.entity_id] = 0;
+            count--;
+            return 1;
+        }
+
+        bool contains(const entity & e) const
+        {
+            return e.entity_id < live.size() && live[e.entity_id];
+        }
+
+        pointer get(const entity & e)
+        {
+            return contains(e) ? pointer(this, e.entity_id) : pointer();
+        }
+
+        typename soaLayout<T>::ref at(std::uint32_t id)
+        {
+            return reference(id, std::make_index_sequence<FIELD_COUNT>{});
+        }
+
+        T load(std::uint32_t id) const
+        {
+            return read(id, std::make_index_sequence<FIELD_COUNT>{});
+        }
+
+        //keeps the allocations for the next scene
+        void clear()
+        {
+            std::apply([](auto &... a) { (..., a.clear()); }, arrays);
+            live.clear();
+            count = 0;
+        }
+
+        //makes room for ids below n
+        void reserve(std::size_t n)
+        {
+            std::apply([&](auto &... a) { (..., a.reserve(n)); }, arrays);
+            live.reserve(n);
+        }
+
+        //makes the arrays at least n long, the new slots are not live
+        //the batched kernels pad every array they read together to the same length
+        void growSlots(std::size_t n)
+        {
+            if (n > live.size()) grow(static_cast<std::uint32_t>(n - 1));
+        }
+
+        //number of live components
+        std::size_t size() const { return count; }
+
+        //length of the arrays, one past the largest id ever stored
+        std::size_t slots() const { return live.size(); }
+
+        //raw array of field I, slots() long, for the batched kernels
+        template <std::size_t I>
+        fieldType<I> * field() { return std::get<I>(arrays).data(); }
+
+        template <std::size_t I>
+        const fieldType<I> * field() const { return std::get<I>(arrays).data(); }
+
+        //1 for every id that has the component, slots() long
+        const std::uint8_t * liveMask() const { return live.data(); }
+
+        iterator begin() { return iterator(this, 0); }
+        iterator end() { return iterator(this, static_cast<std::uint32_t>(live.size())); }
+};
+
+
+//where the manager keeps components of type T, map nodes come from a nodePool
+template <typename T>
+using componentMap = std::unordered_map<entity, T, std::hash<entity>, std::equal_to<entity>,
+                                        nodeAllocator<std::pair<const entity, T>>>;
+
+template <typename T>
+using componentStorage = std::conditional_t<soaLayout<T>::enabled, soaStorage<T>, componentMap<T>>;
+
+//what getComponent returns for T, a plain pointer for map storage
+template <typename T>
+using componentPtr = std::conditional_t<soaLayout<T>::enabled, soaPtr<T>, T *>;
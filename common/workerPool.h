@@ -0,0 +1,128 @@
+// Persistent worker threads for the threaded demos
+// Starting a std::thread per section every frame costs a heap allocation and a thread
+// start each time, and gives every thread local cache a fresh, empty copy. The pool starts
+// its threads once and hands them jobs each frame:
+//
+//   workers.run(sections, threadCount, [&](size_t section) { runSection(section); });
+//
+// run calls job(i) for every i in [0, jobs), spread over threads - 1 workers and the calling
+// thread, and returns once all of them are done, so it works as the join of the old
+// create and join loops. The job is called through a plain function pointer, nothing is
+// allocated per run. The pool is only resized when the thread count changes.
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+class workerPool
+{
+    private:
+        std::vector<std::thread> workers;
+
+        std::mutex lock;
+        std::condition_variable wake;
+        std::condition_variable finished;
+
+        //bumped for every run, workers pick up a run by seeing a new generation
+        std::uint64_t generation = 0;
+        bool quitting = false;
+
+        //current run, set under the lock before the generation is bumped
+        void (*call)(void *, std::size_t) = nullptr;
+        void * context = nullptr;
+        std::size_t jobCount = 0;
+        std::atomic<std::size_t> nextJob{0};
+
+        //workers that have not finished the current run
+        std::size_t busy = 0;
+
+        void drain()
+        {
+            for (std::size_t i = nextJob.fetch_add(1); i < jobCount; i = nextJob.fetch_add(1)) {
+                call(context, i);
+            }
+        }
+
+        //seen is the generation at start, so a new worker does not pick up a finished run
+        void workerLoop(std::uint64_t seen)
+        {
+            for (;;) {
+                {
+                    std::unique_lock<std::mutex> l(lock);
+                    wake.wait(l, [&] { return quitting || generation != seen; });
+                    if (quitting) return;
+                    seen = generation;
+                }
+
+                drain();
+
+                std::lock_guard<std::mutex> l(lock);
+                if (--busy == 0) finished.notify_one();
+            }
+        }
+
+        void stop()
+        {
+            {
+                std::lock_guard<std::mutex> l(lock);
+                quitting = true;
+            }
+            wake.notify_all();
+            for (auto & t : workers) t.join();
+            workers.clear();
+            quitting = false;
+        }
+
+        void resize(std::size_t n)
+        {
+            if (workers.size() == n) return;
+            stop();
+            for (std::size_t i = 0; i < n; i++) workers.emplace_back(&workerPool::workerLoop, this, generation);
+        }
+
+    public:
+        workerPool() = default;
+        workerPool(const workerPool &) = delete;
+        workerPool & operator=(const workerPool &) = delete;
+
+        ~workerPool()
+        {
+            stop();
+        }
+
+        //job(i) for i in [0, jobs) on up to threads threads, the caller being one of them
+        template <typename F>
+        void run(std::size_t jobs, std::size_t threads, F && job)
+        {
+            resize(threads > 1 ? threads - 1 : 0);
+
+            if (workers.empty() || jobs < 2) {
+                for (std::size_t i = 0; i < jobs; i++) job(i);
+                return;
+            }
+
+            using jobType = std::remove_reference_t<F>;
+            {
+                std::lock_guard<std::mutex> l(lock);
+                call = [](void * c, std::size_t i) { (*static_cast<jobType *>(c))(i); };
+                context = const_cast<void *>(static_cast<const void *>(&job));
+                jobCount = jobs;
+                nextJob = 0;
+                busy = workers.size();
+                generation++;
+            }
+            wake.notify_all();
+
+            drain();
+
+            std::unique_lock<std::mutex> l(lock);
+            finished.wait(l, [&] { return busy == 0; });
+        }
+};
@@ -1,7 +1,25 @@
 #pragma once
 
+#include "../common/runConfig.h"
+
 constexpr int WIDTH(1920);
 constexpr int HEIGHT(1080);
 
 constexpr int CIRCLE_COUNT(0);
 constexpr int RECTANGLE_COUNT(800);
+
+//points used to approximate a circle, same as the sf::CircleShape default
+constexpr int CIRCLE_POINTS(30);
+
+//frames the simulation may run ahead of rendering on its own thread
+//0 runs the simulation and rendering serially on the main thread
+constexpr int PIPELINE_DEPTH(1);
+
+//scenario the demo runs with, the constants above are its defaults
+//main() applies command line flags and config files on top, see common/runConfig.h
+//-DFIXED_CONFIG keeps every setting a compile time constant instead
+#ifdef FIXED_CONFIG
+constexpr runConfig config{WIDTH, HEIGHT, RECTANGLE_COUNT, CIRCLE_COUNT, BROADPHASE_BRUTEFORCE, 0, 0, 0, PIPELINE_DEPTH, SCENARIO_UNIFORM, 1, nullptr, nullptr};
+#else
+inline runConfig config{WIDTH, HEIGHT, RECTANGLE_COUNT, CIRCLE_COUNT, BROADPHASE_BRUTEFORCE, 0, 0, 0, PIPELINE_DEPTH, SCENARIO_UNIFORM, 1, nullptr, nullptr};
+#endif
\ No newline at end of file
@@ -1,16 +1,29 @@
 //#pragma GCC diagnostic ignored "-Wthread-safety"
+#pragma once
 
 
 #include "entity.h"
 #include "components.h"
 #include "globals.h"
+#include "../common/profiler.h"
+#include "../common/commandBuffer.h"
+#include "../common/entitySet.h"
+#include "../common/movementKernel.h"
+#include "../common/overlapKernel.h"
+#include "../common/vertexKernel.h"
+#include "../common/frameArena.h"
+#include "../common/workerPool.h"
 
 #include <cmath>
 #include <vector>
 #include <utility>
+#include <sstream>
+#include <cstdint>
 #include <thread>
 #include <algorithm>
 #include <optional>
+#include <array>
+#include <atomic>
 
 #include <SFML/Graphics.hpp>
 #include <SFML/System.hpp>
@@ -19,30 +32,48 @@
 using namespace std;
 
 //handles linear movement for entities with positions and velocities
+//every entity is moved in one batched pass over the position and velocity arrays
 class movementSystem
 {
+    private:
+        //one bit per entity id, set for entities that left the world in the last update
+        vector<uint8_t> oob;
+
     public:
-    //returns false if object goes OOB and is deleted
-    bool updatePosition (const entity & e, velocityComponent* v, positionComponent* p, 
-                        componentManager & cm, std::vector<entity> & ents)
+    void updatePositions(componentManager & cm)
     {
-        //add velocity to position for new position
-        if (v == nullptr) return true;
-        if (p == nullptr) return true;
-
-        p->px += v->vx;
-        p->py += v->vy;
+        auto & pos = cm.getMap<positionComponent>();
+        auto & vel = cm.getMap<velocityComponent>();
+
+        //both storages cover the same ids, padded to whole vectors
+        size_t slots = movementSlots(max(pos.slots(), vel.slots()));
+        pos.growSlots(slots);
+        vel.growSlots(slots);
+        oob.assign(slots / 8, 0);
+
+        movementBatch b;
+        b.px = pos.field<0>();
+        b.py = pos.field<1>();
+        b.vx = vel.field<0>();
+        b.vy = vel.field<1>();
+        b.hasPosition = pos.liveMask();
+        b.hasVelocity = vel.liveMask();
+        b.count = slots;
 
         //OOB checking for objects travelling off into oblivion
-        if (p->px > WIDTH*1.2 || p->px < 0-WIDTH*.2) {
-            return false;
-        }
-        if (p->py > HEIGHT*1.2 || p->py < 0-HEIGHT*.2){
-            return false;
-        }
-        return true;
+        b.minX = 0-config.width*.2;
+        b.maxX = config.width*1.2;
+        b.minY = 0-config.height*.2;
+        b.maxY = config.height*1.2;
+
+        moveEntities(b, oob.data());
+    }
+
+    //true if e went OOB in the last updatePositions
+    bool outOfBounds(const entity & e) const
+    {
+        return movementOutOfBounds(oob, e.entity_id);
     }
-        
 };
 
 //renders rectangles on screen
@@ -52,7 +83,7 @@ class rectRenderSystem
         sf::RectangleShape rectangle;
 
     public:
-        void renderRect(rectangleSizeComponent * rec, positionComponent * p,
+        void renderRect(rectangleSizeComponent * rec, componentPtr<positionComponent> p,
                         colorComponent * c, sf::RenderWindow & window)
         {
             if (rec == nullptr) return;
@@ -64,6 +95,28 @@ class rectRenderSystem
 
             window.draw(rectangle);
         }
+
+        //appends the rectangle as two triangles instead of drawing it
+        //safe to call from worker threads, only the output vector is written
+        void buildRect(rectangleSizeComponent * rec, componentPtr<positionComponent> p,
+                       colorComponent * c, vector<sf::Vertex> & out) const
+        {
+            if (rec == nullptr) return;
+            if (p == nullptr) return;
+
+            sf::Color col(c->r, c->g, c->b);
+            sf::Vector2f tl(p->px, p->py);
+            sf::Vector2f tr(p->px + rec->rx, p->py);
+            sf::Vector2f bl(p->px, p->py + rec->ry);
+            sf::Vector2f br(p->px + rec->rx, p->py + rec->ry);
+
+            out.emplace_back(tl, col);
+            out.emplace_back(tr, col);
+            out.emplace_back(br, col);
+            out.emplace_back(tl, col);
+            out.emplace_back(br, col);
+            out.emplace_back(bl, col);
+        }
 };
 
 //renders circles
@@ -72,8 +125,23 @@ class circRenderSystem
     private:
         sf::CircleShape circle;
 
+        //unit circle points shared by every batched circle, kept as separate x and y arrays
+        //for the rim kernel, the last point repeats the first to close the fan
+        array<float, CIRCLE_POINTS + 1> unitX;
+        array<float, CIRCLE_POINTS + 1> unitY;
+
     public:
-        void renderCirc(circleSizeComponent * r, positionComponent * p,
+        circRenderSystem(){
+            for (int i = 0; i < CIRCLE_POINTS; i++){
+                float angle = i * 2.0f * 3.14159265f / CIRCLE_POINTS;
+                unitX[i] = std::cos(angle);
+                unitY[i] = std::sin(angle);
+            }
+            unitX[CIRCLE_POINTS] = unitX[0];
+            unitY[CIRCLE_POINTS] = unitY[0];
+        }
+
+        void renderCirc(circleSizeComponent * r, componentPtr<positionComponent> p,
                         colorComponent * c, sf::RenderWindow & window)
         {
             if (r == nullptr) return;
@@ -85,32 +153,79 @@ class circRenderSystem
 
             window.draw(circle);
         }
+
+        //appends the circle as a fan of triangles instead of drawing it
+        //safe to call from worker threads, only the output vector is written
+        void buildCirc(circleSizeComponent * r, componentPtr<positionComponent> p,
+                       colorComponent * c, vector<sf::Vertex> & out) const
+        {
+            if (r == nullptr) return;
+            if (p == nullptr) return;
+
+            sf::Color col(c->r, c->g, c->b);
+            float rad = r->r;
+
+            //shapes are positioned by their top left corner like sf::CircleShape
+            sf::Vector2f center(p->px + rad, p->py + rad);
+
+            array<float, CIRCLE_POINTS + 1> rimX;
+            array<float, CIRCLE_POINTS + 1> rimY;
+            circleRim(unitX.data(), unitY.data(), CIRCLE_POINTS + 1, center.x, center.y, rad, rimX.data(), rimY.data());
+
+            for (int i = 0; i < CIRCLE_POINTS; i++){
+                out.emplace_back(center, col);
+                out.emplace_back(sf::Vector2f(rimX[i], rimY[i]), col);
+                out.emplace_back(sf::Vector2f(rimX[i + 1], rimY[i + 1]), col);
+            }
+        }
+};
+
+//geometry produced by one worker thread, grouped by primitive so it can be drawn in bulk
+struct renderBuffer
+{
+    vector<sf::Vertex> rects;
+    vector<sf::Vertex> circles;
+
+    void clear(){
+        rects.clear();
+        circles.clear();
+    }
 };
 
 //checks collisions within the hitbox map
 class collisionSystem
 {
     public:
-    optional<vector<pair<float,float>>> checkCollision(const entity e, positionComponent * p1, hitboxComponent * h1, 
-                        velocityComponent * v1, componentManager & cm){
+    //boxes this close count as touching
+    static constexpr float MARGIN = 0.1f;
+
+    //the log is allocated from arena and lives until it is reset
+    //hits has room for overlapBatchOf(cm).count ids
+    optional<frameVector<pair<float,float>>> checkCollision(const entity e, componentPtr<positionComponent> p1, componentPtr<hitboxComponent> h1, 
+                        componentManager & cm, frameArena & arena, uint32_t * hits){
         //nullptr checks
         if (!p1 || !h1) return nullopt;
 
         //log all collisions that occur, then handle them later
-        vector <pair <float, float>> collisionLog; 
+        frameVector <pair <float, float>> collisionLog{arenaAllocator<pair<float, float>>(arena)}; 
+
+        //test against every hitbox at once, only the overlapping ones are looked at below
+        overlapBatch b = overlapBatchOf(cm);
+        size_t found = findOverlaps(b, {p1->px, p1->py, h1->x, h1->y}, hits);
         
-        //iterate through all ents with a hitbox
-        for (const auto & c : cm.getMap<hitboxComponent>()){
-            if (c.first.entity_id != e.entity_id){
+        //iterate through all ents with a hitbox that overlaps
+        for (size_t i = 0; i < found; i++){
+            entity other(hits[i]);
+            if (other.entity_id != e.entity_id){
 
-                auto * p2 = cm.getComponent<positionComponent>(c.first);
-                hitboxComponent h2 = c.second;
+                auto p2 = cm.getComponent<positionComponent>(other);
+                auto h2 = cm.getComponent<hitboxComponent>(other);
 
                 //nullptr check
                 if (!p2) continue;
 
                 //check object collision
-                char face = getCollisionFace(p1,p2,h1,&h2);
+                char face = getCollisionFace(p1,p2,h1,h2);
 
                 if (face != '\0'){
 
@@ -147,11 +262,29 @@ class collisionSystem
 
 
 
+    //the position and hitbox arrays as one batch for the overlap kernels
+    overlapBatch overlapBatchOf(componentManager & cm){
+        auto & pos = cm.getMap<positionComponent>();
+        auto & box = cm.getMap<hitboxComponent>();
+
+        overlapBatch b;
+        b.px = pos.field<0>();
+        b.py = pos.field<1>();
+        b.hx = box.field<0>();
+        b.hy = box.field<1>();
+        b.hasPosition = pos.liveMask();
+        b.hasHitbox = box.liveMask();
+        b.count = min(pos.slots(), box.slots());
+        b.margin = MARGIN;
+        return b;
+    }
+
+
     //returns the face of the collision (ie. t, b, l, r) returns \0 for no collision
-    char getCollisionFace(positionComponent * p1, positionComponent * p2,
-                          hitboxComponent * h1, hitboxComponent * h2){
+    char getCollisionFace(componentPtr<positionComponent> p1, componentPtr<positionComponent> p2,
+                          componentPtr<hitboxComponent> h1, componentPtr<hitboxComponent> h2){
         //ensure there is a collision before proceeding
-        constexpr float me = 0.1f;
+        constexpr float me = MARGIN;
 
         if (!(p1->px < p2->px + h2->x + me &&
             p1->px + h1->x > p2->px - me &&
@@ -186,6 +319,55 @@ class collisionSystem
 };
 
 
+//draws the fps counter
+//the text is only rebuilt when one of the shown values changes
+class hudSystem
+{
+    private:
+        sf::Text fpsText;
+
+        //values currently on screen, rounded the same way they are displayed
+        float shownFps = -1.0f;
+        size_t shownCount = SIZE_MAX;
+
+    public:
+        hudSystem(const sf::Font & font)
+        {
+            fpsText.setFont(font);
+            fpsText.setCharacterSize(16);
+            fpsText.setFillColor(sf::Color::White);
+            fpsText.setPosition(10.f, 10.f);
+        }
+
+        void setStats(float fps, size_t entityCount)
+        {
+            float rounded = std::round(fps * 10.0f) / 10.0f;
+            if (rounded == shownFps && entityCount == shownCount) return;
+
+            shownFps = rounded;
+            shownCount = entityCount;
+
+            std::ostringstream ss;
+            ss.precision(1);
+            ss << std::fixed << "FPS: " << rounded << endl;
+            ss << std::fixed << "Entity Count: " << entityCount;
+            fpsText.setString(ss.str());
+        }
+
+        void render(sf::RenderWindow & w)
+        {
+            w.draw(fpsText);
+        }
+};
+
+//counters for the last physics step, read by the benchmarks
+struct physicsStats
+{
+    uint64_t pairsTested = 0;
+    uint64_t collisionsFound = 0;
+};
+
+
 //handles all systems in a scene
 //will auto create all systems
 class systemManager
@@ -198,14 +380,41 @@ class systemManager
 
 		size_t threadCount = std::max(static_cast<size_t>(thread::hardware_concurrency()), size_t{1});
 
+        //started once and reused every frame
+        workerPool workers;
+
+        //scratch memory of each thread section, reset at the end of every frame
+        vector<frameArena> arenas;
+
+        //one vertex buffer per thread section, reused every frame to keep the capacity
+        vector<renderBuffer> buffers;
+
+        //structural changes recorded by each thread section, played back after the workers join
+        vector<commandBuffer> commands;
+
+        //headless runs skip building the render geometry
+        bool buildGeometry = true;
+
     public:
+        //counters for the last physics step
+        physicsStats stats;
+
+        void setThreadCount(size_t n) {
+            threadCount = std::max(n, size_t{1});
+        }
+
+        void setBuildGeometry(bool b) {
+            buildGeometry = b;
+        }
+
         //runs all static systems
-        void runStaticSystems(vector<entity>& ent, componentManager & cm, sf::RenderWindow & w){
+        void runStaticSystems(entitySet & ent, componentManager & cm, sf::RenderWindow & w){
+            PROFILE_SCOPE("staticRender");
 
             //draw static entities
             for (auto& e : ent) {
                 auto * s = cm.getComponent<rectangleSizeComponent>(e);
-                auto * p = cm.getComponent<positionComponent>(e);
+                auto p = cm.getComponent<positionComponent>(e);
                 auto * c = cm.getComponent<colorComponent>(e);
                 if (!s) {
                     auto s = cm.getComponent<circleSizeComponent>(e);
@@ -218,27 +427,63 @@ class systemManager
             return;
         }
 
-        //runs all dynamic systems
-        void runDynamicSystems(std::vector <entity> & ent, componentManager & cm, sf::RenderWindow & w){
+        //builds the geometry for static entities without drawing it
+        void buildStaticSystems(entitySet & ent, componentManager & cm, renderBuffer & out){
+            PROFILE_SCOPE("staticBuild");
+            for (auto& e : ent) {
+                auto * s = cm.getComponent<rectangleSizeComponent>(e);
+                auto p = cm.getComponent<positionComponent>(e);
+                auto * c = cm.getComponent<colorComponent>(e);
+                if (!s) {
+                    auto r = cm.getComponent<circleSizeComponent>(e);
+                    cir.buildCirc(r,p,c,out.circles);
+                }else{
+                    rec.buildRect(s,p,c,out.rects);
+                }
+            }
+        }
+
+        //runs collisions, movement and deletion
+        //writes the geometry of every surviving entity into out instead of drawing it
+        void runPhysicsSystems(entitySet & ent, componentManager & cm, vector<renderBuffer> & out){
+            PROFILE_SCOPE("physics");
             
-            //create threads
+            //split the entities into one section per thread
             size_t perThread = ent.size() / threadCount;
             if (perThread == 0) perThread = 1;
-            vector <thread> threads;
+            size_t sections = (ent.size() + perThread - 1) / perThread;
+            if (arenas.size() < sections) arenas.resize(sections);
+
+
+            //totals across all the sections, each section adds its counts once
+            atomic<uint64_t> pairsTested{0};
+            atomic<uint64_t> collisionsFound{0};
 
 
             //lambda for threaded collisions and position updates
-            auto runSectionCol = [&](size_t beginIdx, size_t endIdx) {
+            auto runSectionCol = [&](size_t section) {
+                PROFILE_SCOPE("collision");
+                size_t beginIdx = section * perThread;
+                size_t endIdx = min(beginIdx + perThread, ent.size());
+                frameArena & arena = arenas[section];
+                uint64_t pairs = 0;
+                uint64_t hits = 0;
+
+                //id buffer of the batched overlap test, shared by every entity in the section
+                uint32_t * hitIds = arena.make<uint32_t>(col.overlapBatchOf(cm).count);
 
                 for (size_t idx = beginIdx; idx < endIdx; idx++) {
 
-                    auto* v = cm.getComponent<velocityComponent>(ent[idx]);
-                    auto* h = cm.getComponent<hitboxComponent>(ent[idx]);
-                    auto* p = cm.getComponent<positionComponent>(ent[idx]);
+                    auto v = cm.getComponent<velocityComponent>(ent[idx]);
+                    auto h = cm.getComponent<hitboxComponent>(ent[idx]);
+                    auto p = cm.getComponent<positionComponent>(ent[idx]);
 
 
                     //check entity collisions    
-                    auto c = col.checkCollision(ent[idx], p, h, v, cm);
+                    auto c = col.checkCollision(ent[idx], p, h, cm, arena, hitIds);
+
+                    if (p && h) pairs += cm.getMap<hitboxComponent>().size() - 1;
+                    if (c) hits += c->size();
 
                     //if there is a collision, update the velocity
                     if (c) {
@@ -255,79 +500,95 @@ class systemManager
                     }
                           
                 }
+
+                pairsTested += pairs;
+                collisionsFound += hits;
             };
 
 
-            //list of entities to delete after the positions are updated
-            vector <entity> delList {};
+            //reset the per section vertex buffers
+            if (out.size() < sections) out.resize(sections);
+            for (auto & b : out) b.clear();
+            if (commands.size() < sections) commands.resize(sections);
+
 
             //lambda for update positions
-            auto runSectionPos = [&](size_t startIdx, size_t endIdx){
+            //also builds the render geometry so only the draw calls are left for the main thread
+            auto runSectionPos = [&](size_t section){
+                PROFILE_SCOPE("movement");
+                size_t startIdx = section * perThread;
+                size_t endIdx = min(startIdx + perThread, ent.size());
+                renderBuffer & buf = out[section];
+
                 for (size_t idx = startIdx; idx < endIdx; idx ++){
-                    auto* v = cm.getComponent<velocityComponent>(ent[idx]);
-                    auto* p = cm.getComponent<positionComponent>(ent[idx]);
+                    //positions were already integrated, this only collects the OOB entities
+                    if (mov.outOfBounds(ent[idx])) {
+                        commands[section].destroy(ent[idx]);
+                        continue;
+                    }
 
-                    if (!mov.updatePosition(ent[idx],v,p,cm,ent)) delList.push_back(ent[idx]);
+                    auto p = cm.getComponent<positionComponent>(ent[idx]);
+
+                    if (!buildGeometry) continue;
+
+                    auto *s = cm.getComponent<rectangleSizeComponent>(ent[idx]);
+                    auto *c = cm.getComponent<colorComponent>(ent[idx]);
+
+                    //build circles and squares
+                    if (!s){
+                        auto *r = cm.getComponent<circleSizeComponent>(ent[idx]);
+                        cir.buildCirc(r,p,c,buf.circles);
+                    }else{
+                        rec.buildRect(s,p,c,buf.rects);
+                    }
                 }
             };
 
 
-            //dispatch threads for collision checks
-            for (int i = 0; i < ent.size(); i += perThread) {
-                size_t endIdx = min(i + perThread, ent.size());
-                threads.emplace_back(runSectionCol, i, endIdx);
-            }
-
+            //run the collision checks on the workers, returns once every section is done
+            workers.run(sections, threadCount, runSectionCol);
 
-            //wait for threads
-            for (auto & t : threads) {
-                t.join();
+            //every position is moved in one batched pass before the sections split up
+            {
+                PROFILE_SCOPE("integrate");
+                mov.updatePositions(cm);
             }
 
-            //reset threads
-            threads.clear();
+            //run the position sections
+            workers.run(sections, threadCount, runSectionPos);
 
-            //dispatch threads for position updates
-            for (int i = 0; i < ent.size(); i += perThread) {
-                size_t endIdx = min(i + perThread, ent.size());
-                threads.emplace_back(runSectionPos, i, endIdx);
-            }
+            stats.pairsTested = pairsTested;
+            stats.collisionsFound = collisionsFound;
 
-            //wait for threads
-            for (auto & t : threads) {
-                t.join();
+
+            //delete any ents logged for deletion
+            {
+                PROFILE_SCOPE("deletion");
+                playbackCommands(commands, cm, ent);
             }
 
+            //everything allocated this frame is dead now
+            for (auto & a : arenas) a.reset();
 
-            //delete any ents logged for deletion
-            for (const auto & del : delList){
-                cm.clearEntityComponents(del);
+            return;
+        }
 
-                //delete the entity from the vector of entities
-                auto it = std::find(ent.begin(), ent.end(), del);
-                if (it != ent.end()) {
-                    ent.erase(it);
-                }
+        //draws batched geometry, must be called from the thread that owns the window
+        //all rectangles are submitted first then all circles
+        void submit(const vector<renderBuffer> & bufs, sf::RenderWindow & w){
+            PROFILE_SCOPE("render");
+            for (const auto & b : bufs){
+                if (!b.rects.empty()) w.draw(b.rects.data(), b.rects.size(), sf::Triangles);
             }
-			
-
-            //draw all the dynamic objects
-            for (auto it = ent.begin(); it != ent.end();){
-                auto *p = cm.getComponent<positionComponent>(*it);
-                auto *s = cm.getComponent<rectangleSizeComponent>(*it);
-                auto *c = cm.getComponent<colorComponent>(*it);
-                
-                //draw circles and squares
-                if (!s){
-                    auto *s = cm.getComponent<circleSizeComponent>(*it);
-                    cir.renderCirc(s,p,c,w);
-                }else{
-                    rec.renderRect(s,p,c,w);
-                }
-                it++;
+            for (const auto & b : bufs){
+                if (!b.circles.empty()) w.draw(b.circles.data(), b.circles.size(), sf::Triangles);
             }
+        }
 
-            return;
+        //runs all dynamic systems
+        void runDynamicSystems(entitySet & ent, componentManager & cm, sf::RenderWindow & w){
+            runPhysicsSystems(ent, cm, buffers);
+            submit(buffers, w);
         }
 };
 
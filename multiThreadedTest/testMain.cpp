@@ -6,150 +6,143 @@
 #include "components.h"
 #include "systems.h"
 #include "globals.h"
+#include "../common/snapshot.h"
+#include "../common/prefab.h"
+#include "pipeline.h"
 
 #include <vector>
+#include <algorithm>
 #include <unordered_map>
 #include <sstream>
-#include <cstdlib>    // For rand()
-#include <ctime>      // For seeding rand()
 
 using namespace std;
 
 int entityId(0);
 
-float randInRange(float min, float max) {
-    return min + static_cast<float>(rand()) / RAND_MAX * (max - min);
-}
-
-int main()
+//builds the walls and the scenario preset from scratch
+void buildScene(componentManager & cm, entitySet & staticEntityVec, entitySet & dynamEntityVec)
 {
-    srand(static_cast<unsigned>(time(nullptr)));  // Seed the random number generator
-
-    // --- Create entity vectors
-    vector<entity> staticEntityVec;
-    vector<entity> dynamEntityVec;
-
-    componentManager cm;
-
-    // --- Create system manager
-    systemManager sm;
-
     // --- Create floor rectangle
     entity floor(entityId++);
     staticEntityVec.push_back(floor);
 
-    cm.addComponent<positionComponent>(floor, positionComponent(0, HEIGHT - 10));
-    cm.addComponent<rectangleSizeComponent>(floor, rectangleSizeComponent(WIDTH, 10));
+    cm.addComponent<positionComponent>(floor, positionComponent(0, config.height - 10));
+    cm.addComponent<rectangleSizeComponent>(floor, rectangleSizeComponent(config.width, 10));
     cm.addComponent<colorComponent>(floor, colorComponent(200, 10, 10));
-    cm.addComponent<hitboxComponent>(floor, hitboxComponent(WIDTH, 10,1));
+    cm.addComponent<hitboxComponent>(floor, hitboxComponent(config.width, 10,1));
 
     // --- Create ceiling
     entity ceiling(entityId++);
     staticEntityVec.push_back(ceiling);
 
     cm.addComponent<positionComponent>(ceiling, positionComponent(0, 0));
-    cm.addComponent<rectangleSizeComponent>(ceiling, rectangleSizeComponent(WIDTH, 10));
+    cm.addComponent<rectangleSizeComponent>(ceiling, rectangleSizeComponent(config.width, 10));
     cm.addComponent<colorComponent>(ceiling, colorComponent(10, 10, 200));
-    cm.addComponent<hitboxComponent>(ceiling, hitboxComponent(WIDTH, 10,1));
+    cm.addComponent<hitboxComponent>(ceiling, hitboxComponent(config.width, 10,1));
 
     // --- Create left wall
     entity leftWall(entityId++);
     staticEntityVec.push_back(leftWall);
 
     cm.addComponent<positionComponent>(leftWall, positionComponent(0, 0));
-    cm.addComponent<rectangleSizeComponent>(leftWall, rectangleSizeComponent(10, HEIGHT));
+    cm.addComponent<rectangleSizeComponent>(leftWall, rectangleSizeComponent(10, config.height));
     cm.addComponent<colorComponent>(leftWall, colorComponent(10, 200, 10));
-    cm.addComponent<hitboxComponent>(leftWall, hitboxComponent(10, HEIGHT,1));
+    cm.addComponent<hitboxComponent>(leftWall, hitboxComponent(10, config.height,1));
 
     // --- Create right wall
     entity rightWall(entityId++);
     staticEntityVec.push_back(rightWall);
 
-    cm.addComponent<positionComponent>(rightWall, positionComponent(WIDTH - 10, 0));
-    cm.addComponent<rectangleSizeComponent>(rightWall, rectangleSizeComponent(10, HEIGHT));
+    cm.addComponent<positionComponent>(rightWall, positionComponent(config.width - 10, 0));
+    cm.addComponent<rectangleSizeComponent>(rightWall, rectangleSizeComponent(10, config.height));
     cm.addComponent<colorComponent>(rightWall, colorComponent(10, 200, 10));
-    cm.addComponent<hitboxComponent>(rightWall, hitboxComponent(10, HEIGHT,1));
-
-    // --- Create rectangles
-    for (int i = 0; i < RECTANGLE_COUNT; ++i) {
-        entity e{entityId++};
-
-        int width  = randInRange(5, 20);
-        int height = randInRange(5, 20);
-        float x, y;
-        bool valid;
-
-        // Retry until no collision
-        do {
-            valid = true;
-            x = randInRange(0, WIDTH - width);
-            y = randInRange(0, HEIGHT - height);
-
-            // Check against all dynamic entities
-            for (const auto& other : dynamEntityVec) {
-                auto* pos2 = cm.getComponent<positionComponent>(other);
-                auto* size2 = cm.getComponent<rectangleSizeComponent>(other);
-                if (!pos2 || !size2) continue;
-
-                if (x < pos2->px + size2->rx && x + width > pos2->px &&
-                    y < pos2->py + size2->ry && y + height > pos2->py) {
-                    valid = false;
-                    break;
-                }
-            }
-
-            // Check against all static entities
-            for (const auto& other : staticEntityVec) {
-                auto* pos2 = cm.getComponent<positionComponent>(other);
-                auto* size2 = cm.getComponent<rectangleSizeComponent>(other);
-                if (!pos2 || !size2) continue;
-
-                if (x < pos2->px + size2->rx && x + width > pos2->px &&
-                    y < pos2->py + size2->ry && y + height > pos2->py) {
-                    valid = false;
-                    break;
-                }
-            }
-
-        } while (!valid);
-
-        float vx = randInRange(-4, 4);
-        float vy = randInRange(-4, 4);
-        int r = randInRange(0, 255);
-        int g = randInRange(0, 255);
-        int b = randInRange(0, 255);
-
-        cm.addComponent(e, positionComponent(x, y));
-        cm.addComponent(e, rectangleSizeComponent(width, height));
-        cm.addComponent(e, velocityComponent(vx, vy));
-        cm.addComponent(e, colorComponent(r, g, b));
-        cm.addComponent(e, hitboxComponent(width, height, 1));  // Hitbox = rect size
-
-        dynamEntityVec.push_back(e);
+    cm.addComponent<hitboxComponent>(rightWall, hitboxComponent(10, config.height,1));
+
+    // --- Create rectangles and circles from the scenario preset
+    //the same preset and seed always give the same scene, see common/scenario.h
+    scenarioParams scene;
+    scene.type = config.scenario;
+    scene.seed = config.seed;
+    scene.width = config.width;
+    scene.height = config.height;
+    scene.rectangles = config.rectangleCount;
+    scene.circles = config.circleCount;
+    scene.maxSpeed = 4.0f;
+
+    vector<spawnDesc> spawns;
+    if (!generateScenario(scene, spawns)) {
+        std::cerr << "Scene too dense, placed " << spawns.size() << " of "
+                  << config.rectangleCount + config.circleCount << " entities\n";
     }
 
-    // --- Create circles
-    for (int i = 0; i < CIRCLE_COUNT; ++i) {
-        entity e{entityId++};
-
-        int radius = randInRange(5, 20);
-        int x      = randInRange(radius, WIDTH - radius);
-        int y      = randInRange(radius, HEIGHT - radius);
-        float vx   = randInRange(-2, 2);
-        float vy   = randInRange(-2, 2);
-        int r      = randInRange(0, 255);
-        int g      = randInRange(0, 255);
-        int b      = randInRange(0, 255);
-
-        cm.addComponent(e, positionComponent(x, y));
-        cm.addComponent(e, circleSizeComponent(radius));
-        cm.addComponent(e, velocityComponent(vx, vy));
-        cm.addComponent(e, colorComponent(r, g, b));
-        cm.addComponent(e, hitboxComponent(radius * 2, radius * 2, 1));  // Approximate as square
-
-        dynamEntityVec.push_back(e);
+    //every shape is made in bulk from its prefab, then given the values the preset picked
+    prefab rectPrefab;
+    rectPrefab.set(positionComponent())
+              .set(rectangleSizeComponent())
+              .set(velocityComponent())
+              .set(colorComponent())
+              .set(hitboxComponent(0, 0, 1));
+
+    prefab circlePrefab;
+    circlePrefab.set(positionComponent())
+                .set(circleSizeComponent())
+                .set(velocityComponent())
+                .set(colorComponent())
+                .set(hitboxComponent(0, 0, 1));
+
+    size_t rectCount = count_if(spawns.begin(), spawns.end(), [](const spawnDesc & s) { return s.shape == SPAWN_RECT; });
+    entityRange rects = instantiate(cm, rectPrefab, rectCount, entityId);
+    entityRange circles = instantiate(cm, circlePrefab, spawns.size() - rectCount, entityId);
+    dynamEntityVec.insert(rects.begin(), rects.end());
+    dynamEntityVec.insert(circles.begin(), circles.end());
+
+    size_t nextRect = 0;
+    size_t nextCircle = 0;
+    for (const auto & s : spawns) {
+        entity e = s.shape == SPAWN_RECT ? rects[nextRect++] : circles[nextCircle++];
+
+        auto p = cm.getComponent<positionComponent>(e);
+        p->px = s.x;
+        p->py = s.y;
+        auto v = cm.getComponent<velocityComponent>(e);
+        v->vx = s.vx;
+        v->vy = s.vy;
+        auto h = cm.getComponent<hitboxComponent>(e);
+        h->x = packExtent(s.w);
+        h->y = packExtent(s.h);
+
+        *cm.getComponent<colorComponent>(e) = colorComponent(s.r, s.g, s.b);
+        if (s.shape == SPAWN_RECT) *cm.getComponent<rectangleSizeComponent>(e) = rectangleSizeComponent(s.w, s.h);
+        else cm.getComponent<circleSizeComponent>(e)->r = s.w / 2;
+    }
+}
+
+int main(int argc, char ** argv)
+{
+#ifndef FIXED_CONFIG
+    if (!parseRunConfig(argc, argv, config)) return 1;
+#endif
+
+    // --- Create entity vectors
+    entitySet staticEntityVec;
+    entitySet dynamEntityVec;
+
+    componentManager cm;
+
+    // --- Create system manager
+    systemManager sm;
+    if (config.threads > 0) sm.setThreadCount(config.threads);
+
+    // --- Build the scene, or load a snapshot of one
+    if (config.loadPath) {
+        if (!loadSnapshot(config.loadPath, cm, {&staticEntityVec, &dynamEntityVec})) return 1;
+        entityId = nextFreeEntityId({&staticEntityVec, &dynamEntityVec});
+    } else {
+        buildScene(cm, staticEntityVec, dynamEntityVec);
     }
 
+    if (config.savePath && !saveSnapshot(config.savePath, cm, {&staticEntityVec, &dynamEntityVec})) return 1;
+
     // framerate tracking data
     sf::Clock fpsClock;
     float fpsTimer = 0.0f;
@@ -163,21 +156,26 @@ int main()
         return 1;
     }
 
-    sf::Text fpsText;
-    fpsText.setFont(font);
-    fpsText.setCharacterSize(16);
-    fpsText.setFillColor(sf::Color::White);
-    fpsText.setPosition(10.f, 10.f);
+    hudSystem hud(font);
 
     //init entity count
     int entCount = staticEntityVec.size() + dynamEntityVec.size();
 
     // --- Create SFML window at 1080p HS resolution
-    sf::RenderWindow window(sf::VideoMode(WIDTH, HEIGHT), "2d_game_sfml");
+    sf::RenderWindow window(sf::VideoMode(config.width, config.height), "2d_game_sfml");
     window.setFramerateLimit(120);
 
+    //pipelined mode simulates ahead of rendering on its own thread
+    //the component manager and dynamic entities belong to that thread while it runs
+    framePipeline pipeline(sm, cm, staticEntityVec, dynamEntityVec, config.pipelineDepth);
+    if (config.pipelineDepth > 0) pipeline.start();
+
+    size_t dynamCount = dynamEntityVec.size();
+
     while (window.isOpen())
     {
+        PROFILE_SCOPE("frame");
+
         sf::Event event;
         while (window.pollEvent(event))
         {
@@ -187,34 +185,42 @@ int main()
 
         window.clear();
 
-        // --- Render static entities
-        sm.runStaticSystems(staticEntityVec, cm, window);
+        if (config.pipelineDepth > 0) {
+            // --- Draw the oldest simulated frame while the next ones are computed
+            dynamCount = pipeline.renderNext(window);
+        } else {
+            // --- Render static entities
+            sm.runStaticSystems(staticEntityVec, cm, window);
 
-        // --- Render dynamic entities
-        sm.runDynamicSystems(dynamEntityVec, cm, window);
+            // --- Render dynamic entities
+            sm.runDynamicSystems(dynamEntityVec, cm, window);
+            dynamCount = dynamEntityVec.size();
+        }
 
         //render framerate
         frameCount++;
         fpsTimer += fpsClock.restart().asSeconds();
 
         if (fpsTimer >= 0.5f) { // update every half second
-            entCount = dynamEntityVec.size() + staticEntityVec.size();
+            entCount = dynamCount + staticEntityVec.size();
             currentFPS = frameCount / fpsTimer;
         
-            std::ostringstream ss;
-            ss.precision(1);
-            ss << std::fixed << "FPS: " << currentFPS << endl;
-            ss << std::fixed << "Entity Count: " << entCount;
-            fpsText.setString(ss.str());
+            hud.setStats(currentFPS, entCount);
         
             frameCount = 0;
             fpsTimer = 0.0f;
         }        
 
-        window.draw(fpsText);
+        hud.render(window);
 
         window.display();
     }
 
+    pipeline.stop();
+
+    //write the capture and the per system percentiles when built with -DPROFILE
+    PROFILE_DUMP("trace.json");
+    PROFILE_REPORT("frame_stats.csv");
+
     return 0;
 }
@@ -27,8 +27,8 @@ int main()
     srand(static_cast<unsigned>(time(nullptr)));  // Seed the random number generator
 
     //create entity vectors
-    vector<entity> staticEntityVec;
-    vector<entity> dynamEntityVec;
+    entitySet staticEntityVec;
+    entitySet dynamEntityVec;
     componentManager cm;
     
     //create system manager
@@ -1,6 +1,7 @@
 #include "entity.h"
 #include "components.h"
 #include "globals.h"
+#include "../common/entitySet.h"
 
 #include <cmath>
 #include <vector>
@@ -18,7 +19,7 @@ class movementSystem
     public:
     //returns false if object goes OOB and is deleted
     bool updatePosition (const entity & e, velocityComponent* v, positionComponent* p, 
-                        componentManager & cm, std::vector<entity> & ents)
+                        componentManager & cm, entitySet & ents)
     {
         //add velocity to position for new position
         if (v == nullptr) return true;
@@ -31,21 +32,15 @@ class movementSystem
         if (p->px > WIDTH*1.2 || p->px < 0-WIDTH*.2) {
             cm.clearEntityComponents(e);
 
-            //delete the entity from the vector of entities
-            auto it = std::find(ents.begin(), ents.end(), e);
-            if (it != ents.end()) {
-                ents.erase(it);
-            }
+            //delete the entity from the set of entities
+            ents.erase(e);
             return false;
         }
         if (p->py > HEIGHT*1.2 || p->py < 0-HEIGHT*.2){
             cm.clearEntityComponents(e);
 
-            //delete the entity from the vector of entities
-            auto it = std::find(ents.begin(), ents.end(), e);
-            if (it != ents.end()) {
-                ents.erase(it);
-            }
+            //delete the entity from the set of entities
+            ents.erase(e);
             return false;
         }
         return true;
@@ -234,7 +229,7 @@ class systemManager
         collisionSystem col;
     public:
         //runs all static systems
-        void runStaticSystems(std::vector<entity>& ent, componentManager & cm, sf::RenderWindow & w){
+        void runStaticSystems(entitySet& ent, componentManager & cm, sf::RenderWindow & w){
             for (auto & e : ent){
                 auto * s = cm.getComponent<rectangleSizeComponent>(e);
                 auto * p = cm.getComponent<positionComponent>(e);
@@ -250,28 +245,30 @@ class systemManager
         }
 
         //runs all dynamic systems
-        void runDynamicSystems(std::vector <entity> & ent, componentManager & cm, sf::RenderWindow & w){
-            for (auto it = ent.begin(); it != ent.end();){
-                auto *v = cm.getComponent<velocityComponent>(*it);
-                auto *h = cm.getComponent<hitboxComponent>(*it);
-                auto *p = cm.getComponent<positionComponent>(*it);
-                auto *s = cm.getComponent<rectangleSizeComponent>(*it);
-                auto *c = cm.getComponent<colorComponent>(*it);
+        //an erase moves the last entity into slot i, so i is only advanced for survivors
+        void runDynamicSystems(entitySet & ent, componentManager & cm, sf::RenderWindow & w){
+            for (size_t i = 0; i < ent.size();){
+                entity e = ent[i];
+                auto *v = cm.getComponent<velocityComponent>(e);
+                auto *h = cm.getComponent<hitboxComponent>(e);
+                auto *p = cm.getComponent<positionComponent>(e);
+                auto *s = cm.getComponent<rectangleSizeComponent>(e);
+                auto *c = cm.getComponent<colorComponent>(e);
             
                 //check entity collisions    
-                col.checkCollision(*it,p,h,v,cm);
+                col.checkCollision(e,p,h,v,cm);
 
                 //if object is deleted, dont draw
-                if (!mov.updatePosition(*it,v,p,cm,ent)) continue;                
+                if (!mov.updatePosition(e,v,p,cm,ent)) continue;                
                 
                 //draw circles and squares
                 if (!s){
-                    auto *s = cm.getComponent<circleSizeComponent>(*it);
+                    auto *s = cm.getComponent<circleSizeComponent>(e);
                     cir.renderCirc(s,p,c,w);
                 }else{
                     rec.renderRect(s,p,c,w);
                 }
-                it++;
+                i++;
             }
         }
 };
@@ -26,8 +26,8 @@ int main()
     srand(static_cast<unsigned>(time(nullptr)));  // Seed the random number generator
 
     // --- Create entity vectors
-    vector<entity> staticEntityVec;
-    vector<entity> dynamEntityVec;
+    entitySet staticEntityVec;
+    entitySet dynamEntityVec;
 
     componentManager cm;
 
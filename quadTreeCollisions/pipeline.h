@@ -0,0 +1,127 @@
+// Pipelined frames: the simulation runs on its own thread and writes
+// finished geometry into a ring of snapshots that the render thread
+// draws one or more frames later
+
+#pragma once
+
+#include "systems.h"
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+using namespace std;
+
+//a simulated frame waiting to be drawn
+struct frameSnapshot
+{
+	vector<renderBuffer> sections;
+	size_t entityCount = 0;
+};
+
+
+class framePipeline
+{
+private:
+	systemManager& sm;
+	componentManager& cm;
+	entitySet& ents;
+
+	//depth + 1 slots so one can be drawn while the others are written
+	vector<frameSnapshot> slots;
+
+	//static entities never move so their geometry is built once
+	vector<renderBuffer> staticGeometry;
+
+	//frame counters, the slot in use is the counter modulo the slot count
+	size_t produced = 0;
+	size_t consumed = 0;
+	bool running = false;
+
+	mutex m;
+	condition_variable cv;
+	thread simThread;
+
+
+	//simulation thread loop, stays at most depth frames ahead of the renderer
+	void simulate() {
+		while (true) {
+			size_t slot;
+			{
+				unique_lock<mutex> lock(m);
+				cv.wait(lock, [&] { return !running || produced - consumed < slots.size(); });
+				if (!running) return;
+				slot = produced % slots.size();
+			}
+
+			frameSnapshot& snap = slots[slot];
+			sm.runPhysicsSystems(ents, cm, snap.sections);
+			snap.entityCount = ents.size();
+
+			{
+				lock_guard<mutex> lock(m);
+				produced++;
+			}
+			cv.notify_all();
+		}
+	}
+
+public:
+	//the component manager and dynamic entities belong to the simulation thread while running
+	framePipeline(systemManager& s, componentManager& c, entitySet& staticEnts,
+		entitySet& dynamEnts, size_t depth)
+		: sm(s), cm(c), ents(dynamEnts), slots(depth + 1), staticGeometry(1)
+	{
+		sm.buildStaticSystems(staticEnts, cm, staticGeometry[0]);
+	}
+
+	~framePipeline() {
+		stop();
+	}
+
+
+	//starts simulating on a separate thread
+	void start() {
+		running = true;
+		simThread = thread(&framePipeline::simulate, this);
+	}
+
+
+	//stops and joins the simulation thread
+	void stop() {
+		{
+			lock_guard<mutex> lock(m);
+			running = false;
+		}
+		cv.notify_all();
+		if (simThread.joinable()) simThread.join();
+	}
+
+
+	//draws the oldest finished frame, waiting for the simulation if none is ready
+	//returns the dynamic entity count of the frame that was drawn
+	size_t renderNext(sf::RenderWindow& w) {
+		size_t slot;
+		{
+			PROFILE_SCOPE("waitForFrame");
+			unique_lock<mutex> lock(m);
+			cv.wait(lock, [&] { return !running || produced != consumed; });
+			if (produced == consumed) return 0;
+			slot = consumed % slots.size();
+		}
+
+		const frameSnapshot& snap = slots[slot];
+		sm.submit(staticGeometry, w);
+		sm.submit(snap.sections, w);
+		size_t count = snap.entityCount;
+
+		{
+			lock_guard<mutex> lock(m);
+			consumed++;
+		}
+		cv.notify_all();
+
+		return count;
+	}
+};
@@ -4,8 +4,9 @@
 #include "components.h"
 #include "entity.h"
 #include "globals.h"
+#include "../common/entitySet.h"
+#include "../common/frameArena.h"
 
-#include <memory>
 #include <array>
 #include <vector>
 
@@ -25,7 +26,7 @@ class quadTree
 {
 private:
 	unsigned int level;
-	vector<entity> objects;
+	frameVector<entity> objects;
 
 	//origin of the area
 	int oX, oY;
@@ -33,15 +34,18 @@ private:
 	//bounds of the area
 	int bX, bY;
 
-	//nodes of the quadtree
-	array<unique_ptr<quadTree>, 4> nodes;
+	//nodes of the quadtree, allocated from the arena and dropped when it is reset
+	array<quadTree*, 4> nodes;
 
 	//reference to the component manager
 	componentManager& cm;
 
+	//arena the nodes and their object lists live in
+	frameArena& arena;
+
 public:
-	quadTree(int level, int x, int y, int width, int height, componentManager& c)
-		: level(level), oX(x), oY(y), bX(width), bY(height), cm(c)
+	quadTree(int level, int x, int y, int width, int height, componentManager& c, frameArena& a)
+		: level(level), objects(arenaAllocator<entity>(a)), oX(x), oY(y), bX(width), bY(height), cm(c), arena(a)
 	{
 		nodes[0] = nullptr;
 		nodes[1] = nullptr;
@@ -49,7 +53,8 @@ public:
 		nodes[3] = nullptr;
 	}
 
-	quadTree(componentManager& c) : level(0), oX(0), oY(0), bX(WIDTH), bY(HEIGHT), cm(c)
+	quadTree(componentManager& c, frameArena& a)
+		: level(0), objects(arenaAllocator<entity>(a)), oX(0), oY(0), bX(config.width), bY(config.height), cm(c), arena(a)
 	{
 		nodes[0] = nullptr;
 		nodes[1] = nullptr;
@@ -61,13 +66,13 @@ public:
 
 
 	//builds the quadtree with the given entities
-	void buildTree(vector<entity>& ents) {
+	void buildTree(const entitySet& ents) {
 		insertNodes(ents);
 	}
 
 
-	//inserts a vector of entities into the quadtree
-	void insertNodes(vector<entity>& ent) {
+	//inserts a set of entities into the quadtree
+	void insertNodes(const entitySet& ent) {
 		for (auto& i : ent) {
 			insertNode(i);
 		}
@@ -75,14 +80,9 @@ public:
 
 
 	//clears the quadtree and resets all nodes
+	//the children are only dropped, their memory goes back when the arena is reset
 	void clearTree() {
-		objects.clear();
-		for (auto& i : nodes) {
-			if (i != nullptr) {
-				i->clearTree();
-				i.reset();
-			}
-		}
+		objects = frameVector<entity>(arenaAllocator<entity>(arena));
 		nodes[0] = nullptr;
 		nodes[1] = nullptr;
 		nodes[2] = nullptr;
@@ -92,12 +92,12 @@ public:
 
 
 	//inserts an entity into the quadtree
-	void insertNode(entity& ent) {
+	void insertNode(const entity& ent) {
 		DBG("Inserting ent " << ent.entity_id);
 
 		//checks if the entity is in bounds of the quadtree node
 		//inserts if the node has no children and the object count is less than the max objects
-		if (nodes[0] == nullptr && objects.size() < MAX_OBJECTS) {
+		if (nodes[0] == nullptr && objects.size() < config.maxObjects) {
 			if (inBounds(ent)) {
 				DBG("Ent inserted into node " << level);
 				objects.push_back(ent);
@@ -107,7 +107,7 @@ public:
 
 
 		//splits the node if the objecct count gets too high
-		if (nodes[0] == nullptr && objects.size() >= MAX_OBJECTS && level < MAX_LEVEL) {
+		if (nodes[0] == nullptr && objects.size() >= config.maxObjects && level < config.maxLevel) {
 			DBG("Splitting node " << level);
 			split();
 
@@ -125,7 +125,7 @@ public:
 			return;
 		}
 
-		if (level == MAX_LEVEL){
+		if (level == config.maxLevel){
 			objects.push_back(ent);
 
 			return;
@@ -141,10 +141,10 @@ public:
 		int x = oX;
 		int y = oY;
 
-		nodes[0] = make_unique<quadTree>(level + 1, x + subWidth, y, subWidth, subHeight, cm);
-		nodes[1] = make_unique<quadTree>(level + 1, x, y, subWidth, subHeight, cm);
-		nodes[2] = make_unique<quadTree>(level + 1, x, y + subHeight, subWidth, subHeight, cm);
-		nodes[3] = make_unique<quadTree>(level + 1, x + subWidth, y + subHeight, subWidth, subHeight, cm);
+		nodes[0] = arena.create<quadTree>(level + 1, x + subWidth, y, subWidth, subHeight, cm, arena);
+		nodes[1] = arena.create<quadTree>(level + 1, x, y, subWidth, subHeight, cm, arena);
+		nodes[2] = arena.create<quadTree>(level + 1, x, y + subHeight, subWidth, subHeight, cm, arena);
+		nodes[3] = arena.create<quadTree>(level + 1, x + subWidth, y + subHeight, subWidth, subHeight, cm, arena);
 
 		for (auto& i : objects) {
 			for (auto& j : nodes) {
@@ -159,9 +159,9 @@ public:
 
 
 	//checks if the entity is in bounds of the quadtree node
-	bool inBounds(entity& ent) {
-		auto* p1 = cm.getComponent<positionComponent>(ent);
-		auto* h1 = cm.getComponent<hitboxComponent>(ent);
+	bool inBounds(const entity& ent) {
+		auto p1 = cm.getComponent<positionComponent>(ent);
+		auto h1 = cm.getComponent<hitboxComponent>(ent);
 		if (!p1 || !h1) return false;
 
 		if (p1->px < oX + bX + EPSILON_ME &&
@@ -176,13 +176,10 @@ public:
 	}
 
 
-	//returns a vector of entities that are near the given entity and may collide
-	vector<entity> getCollisions(entity& ent) {
-		//stores the entities to check
-		vector<entity> collidingEntities{};
-
+	//appends the entities that are near the given entity and may collide to collidingEntities
+	void getCollisions(const entity& ent, frameVector<entity>& collidingEntities) {
 		//check if the entity is in bounds
-		if (!inBounds(ent)) return collidingEntities;
+		if (!inBounds(ent)) return;
 
 		//check if the entity is in the current node
 		if (!objects.empty() && nodes[0] == nullptr) {
@@ -197,10 +194,7 @@ public:
 		for (auto& i : nodes) {
 			DBG("Checking child nodes in getCollisions");
 			if (i == nullptr) continue;
-			auto temp = i->getCollisions(ent);
-			collidingEntities.insert(collidingEntities.end(), temp.begin(), temp.end());
+			i->getCollisions(ent, collidingEntities);
 		}
-
-		return collidingEntities;
 	}
 };
@@ -1,7 +1,18 @@
 #pragma once
 
+#include "../common/runConfig.h"
+
 constexpr int WIDTH(1920);
 constexpr int HEIGHT(1080);
 
 constexpr int CIRCLE_COUNT(100);
 constexpr int RECTANGLE_COUNT(100);
+
+//scenario the demo runs with, the constants above are its defaults
+//main() applies command line flags and config files on top, see common/runConfig.h
+//-DFIXED_CONFIG keeps every setting a compile time constant instead
+#ifdef FIXED_CONFIG
+constexpr runConfig config{WIDTH, HEIGHT, RECTANGLE_COUNT, CIRCLE_COUNT, BROADPHASE_BRUTEFORCE, 1, 0, 0, 0, SCENARIO_UNIFORM, 1, nullptr, nullptr};
+#else
+inline runConfig config{WIDTH, HEIGHT, RECTANGLE_COUNT, CIRCLE_COUNT, BROADPHASE_BRUTEFORCE, 1, 0, 0, 0, SCENARIO_UNIFORM, 1, nullptr, nullptr};
+#endif
@@ -1,10 +1,20 @@
+#pragma once
+
 #include "entity.h"
 #include "components.h"
 #include "globals.h"
+#include "../common/profiler.h"
+#include "../common/commandBuffer.h"
+#include "../common/entitySet.h"
+#include "../common/movementKernel.h"
+#include "../common/overlapKernel.h"
+#include "../common/frameArena.h"
 
 #include <cmath>
 #include <vector>
 #include <utility>
+#include <sstream>
+#include <cstdint>
 
 #include <SFML/Graphics.hpp>
 #include <SFML/System.hpp>
@@ -13,44 +23,48 @@
 using namespace std;
 
 //handles linear movement for entities with positions and velocities
+//every entity is moved in one batched pass over the position and velocity arrays
 class movementSystem
 {
+    private:
+        //one bit per entity id, set for entities that left the world in the last update
+        vector<uint8_t> oob;
+
     public:
-    //returns false if object goes OOB and is deleted
-    bool updatePosition (const entity & e, velocityComponent* v, positionComponent* p, 
-                        componentManager & cm, std::vector<entity> & ents)
+    void updatePositions(componentManager & cm)
     {
-        //add velocity to position for new position
-        if (v == nullptr) return true;
-        if (p == nullptr) return true;
-
-        p->px += v->vx;
-        p->py += v->vy;
+        auto & pos = cm.getMap<positionComponent>();
+        auto & vel = cm.getMap<velocityComponent>();
+
+        //both storages cover the same ids, padded to whole vectors
+        size_t slots = movementSlots(max(pos.slots(), vel.slots()));
+        pos.growSlots(slots);
+        vel.growSlots(slots);
+        oob.assign(slots / 8, 0);
+
+        movementBatch b;
+        b.px = pos.field<0>();
+        b.py = pos.field<1>();
+        b.vx = vel.field<0>();
+        b.vy = vel.field<1>();
+        b.hasPosition = pos.liveMask();
+        b.hasVelocity = vel.liveMask();
+        b.count = slots;
 
         //OOB checking for objects travelling off into oblivion
-        if (p->px > WIDTH*1.2 || p->px < 0-WIDTH*.2) {
-            cm.clearEntityComponents(e);
+        b.minX = 0-config.width*.2;
+        b.maxX = config.width*1.2;
+        b.minY = 0-config.height*.2;
+        b.maxY = config.height*1.2;
 
-            //delete the entity from the vector of entities
-            auto it = std::find(ents.begin(), ents.end(), e);
-            if (it != ents.end()) {
-                ents.erase(it);
-            }
-            return false;
-        }
-        if (p->py > HEIGHT*1.2 || p->py < 0-HEIGHT*.2){
-            cm.clearEntityComponents(e);
+        moveEntities(b, oob.data());
+    }
 
-            //delete the entity from the vector of entities
-            auto it = std::find(ents.begin(), ents.end(), e);
-            if (it != ents.end()) {
-                ents.erase(it);
-            }
-            return false;
-        }
-        return true;
+    //true if e went OOB in the last updatePositions
+    bool outOfBounds(const entity & e) const
+    {
+        return movementOutOfBounds(oob, e.entity_id);
     }
-        
 };
 
 //renders rectangles on screen
@@ -60,7 +74,7 @@ class rectRenderSystem
         sf::RectangleShape rectangle;
 
     public:
-        void renderRect(rectangleSizeComponent * rec, positionComponent * p,
+        void renderRect(rectangleSizeComponent * rec, componentPtr<positionComponent> p,
                         colorComponent * c, sf::RenderWindow & window)
         {
             if (rec == nullptr) return;
@@ -81,7 +95,7 @@ class circRenderSystem
         sf::CircleShape circle;
 
     public:
-        void renderCirc(circleSizeComponent * r, positionComponent * p,
+        void renderCirc(circleSizeComponent * r, componentPtr<positionComponent> p,
                         colorComponent * c, sf::RenderWindow & window)
         {
             if (r == nullptr) return;
@@ -98,28 +112,53 @@ class circRenderSystem
 //checks collisions within the hitbox map
 class collisionSystem
 {
+    private:
+        //ids the batched overlap test found for the current entity
+        vector<uint32_t> hits;
+
+        //wider than the margin getCollisionFace allows, so every box it accepts is among the
+        //batched hits and it still makes the final call
+        static constexpr float PREFILTER_MARGIN = 1.0f;
+
     public:
-    bool checkCollision(const entity e, positionComponent * p1, hitboxComponent * h1, 
-                        velocityComponent * v1, componentManager & cm){
+    //returns the number of faces that collided, the log is allocated from arena
+    size_t checkCollision(const entity e, componentPtr<positionComponent> p1, componentPtr<hitboxComponent> h1, 
+                        componentPtr<velocityComponent> v1, componentManager & cm, frameArena & arena){
         //nullptr checks
-        if (!p1 || !h1) return false;
-        bool collide = false;
+        if (!p1 || !h1) return 0;
 
         //log all collisions that occur, then handle them later
-        vector <pair <float, float>> collisionLog; 
+        frameVector <pair <float, float>> collisionLog{arenaAllocator<pair<float, float>>(arena)}; 
+
+        //test against every hitbox at once, only the overlapping ones are looked at below
+        auto & pos = cm.getMap<positionComponent>();
+        auto & box = cm.getMap<hitboxComponent>();
+        overlapBatch b;
+        b.px = pos.field<0>();
+        b.py = pos.field<1>();
+        b.hx = box.field<0>();
+        b.hy = box.field<1>();
+        b.hasPosition = pos.liveMask();
+        b.hasHitbox = box.liveMask();
+        b.count = min(pos.slots(), box.slots());
+        b.margin = PREFILTER_MARGIN;
+
+        hits.resize(b.count);
+        size_t found = findOverlaps(b, {p1->px, p1->py, h1->x, h1->y}, hits.data());
         
-        //iterate through all ents with a hitbox
-        for (auto & c : cm.getMap<hitboxComponent>()){
-            if (c.first.entity_id != e.entity_id){
+        //iterate through all ents with a hitbox that overlaps
+        for (size_t i = 0; i < found; i++){
+            entity other(hits[i]);
+            if (other.entity_id != e.entity_id){
 
-                auto * p2 = cm.getComponent<positionComponent>(c.first);
-                hitboxComponent & h2 = c.second;
+                auto p2 = cm.getComponent<positionComponent>(other);
+                auto h2 = cm.getComponent<hitboxComponent>(other);
 
                 //nullptr checks
                 if (!p1 || !p2) continue;
 
                 //check object collision
-                char face = getCollisionFace(p1,p2,h1,&h2);
+                char face = getCollisionFace(p1,p2,h1,h2);
 
                 if (face != '\0'){
 
@@ -149,21 +188,20 @@ class collisionSystem
                         //cout << "CASE B\n";
                         break;
                     }
-                    collide = true;
                 
                     }
             }
         }
 
 
-        return collide;
+        return collisionLog.size();
     }
 
 
 
     //returns the face of the colission (ie. t, b, l, r) returns \0 for no collision
-    char getCollisionFace(positionComponent * p1, positionComponent * p2,
-                          hitboxComponent * h1, hitboxComponent * h2){
+    char getCollisionFace(componentPtr<positionComponent> p1, componentPtr<positionComponent> p2,
+                          componentPtr<hitboxComponent> h1, componentPtr<hitboxComponent> h2){
         //ensure there is a colision before proceeding
         float me = 0.1f;
 
@@ -200,6 +238,55 @@ class collisionSystem
 };
 
 
+//draws the fps counter
+//the text is only rebuilt when one of the shown values changes
+class hudSystem
+{
+    private:
+        sf::Text fpsText;
+
+        //values currently on screen, rounded the same way they are displayed
+        float shownFps = -1.0f;
+        size_t shownCount = SIZE_MAX;
+
+    public:
+        hudSystem(const sf::Font & font)
+        {
+            fpsText.setFont(font);
+            fpsText.setCharacterSize(16);
+            fpsText.setFillColor(sf::Color::White);
+            fpsText.setPosition(10.f, 10.f);
+        }
+
+        void setStats(float fps, size_t entityCount)
+        {
+            float rounded = std::round(fps * 10.0f) / 10.0f;
+            if (rounded == shownFps && entityCount == shownCount) return;
+
+            shownFps = rounded;
+            shownCount = entityCount;
+
+            std::ostringstream ss;
+            ss.precision(1);
+            ss << std::fixed << "FPS: " << rounded << endl;
+            ss << std::fixed << "Entity Count: " << entityCount;
+            fpsText.setString(ss.str());
+        }
+
+        void render(sf::RenderWindow & w)
+        {
+            w.draw(fpsText);
+        }
+};
+
+//counters for the last physics step, read by the benchmarks
+struct physicsStats
+{
+    uint64_t pairsTested = 0;
+    uint64_t collisionsFound = 0;
+};
+
+
 //handles all systems in a scene
 //will auto create all systems
 class systemManager
@@ -209,12 +296,19 @@ class systemManager
         circRenderSystem cir;
         movementSystem mov;
         collisionSystem col;
+
+        //structural changes recorded while iterating, played back once the loop is done
+        vector<commandBuffer> commands = vector<commandBuffer>(1);
+
+        //scratch memory of one physics step, reset at the end of it
+        frameArena arena;
     public:
         //runs all static systems
-        void runStaticSystems(std::vector<entity>& ent, componentManager & cm, sf::RenderWindow & w){
+        void runStaticSystems(entitySet & ent, componentManager & cm, sf::RenderWindow & w){
+            PROFILE_SCOPE("staticRender");
             for (auto & e : ent){
                 auto * s = cm.getComponent<rectangleSizeComponent>(e);
-                auto * p = cm.getComponent<positionComponent>(e);
+                auto p = cm.getComponent<positionComponent>(e);
                 auto * c = cm.getComponent<colorComponent>(e);
                 if (!s) {
                     auto s = cm.getComponent<circleSizeComponent>(e);
@@ -226,29 +320,64 @@ class systemManager
             return;
         }
 
-        //runs all dynamic systems
-        void runDynamicSystems(std::vector <entity> & ent, componentManager & cm, sf::RenderWindow & w){
-            for (auto it = ent.begin(); it != ent.end();){
-                auto *v = cm.getComponent<velocityComponent>(*it);
-                auto *h = cm.getComponent<hitboxComponent>(*it);
-                auto *p = cm.getComponent<positionComponent>(*it);
-                auto *s = cm.getComponent<rectangleSizeComponent>(*it);
-                auto *c = cm.getComponent<colorComponent>(*it);
+        //counters for the last physics step
+        physicsStats stats;
+
+        //runs collisions and movement without drawing
+        void runPhysicsSystems(entitySet & ent, componentManager & cm){
+            PROFILE_SCOPE("physics");
+            stats = {};
+
+            for (const auto & e : ent){
+                auto v = cm.getComponent<velocityComponent>(e);
+                auto h = cm.getComponent<hitboxComponent>(e);
+                auto p = cm.getComponent<positionComponent>(e);
             
-                //check entity collisions    
-                col.checkCollision(*it,p,h,v,cm);
+                //check entity collisions against every other hitbox
+                if (p && h) stats.pairsTested += cm.getMap<hitboxComponent>().size() - 1;
+                stats.collisionsFound += col.checkCollision(e,p,h,v,cm,arena);
+            }
+
+            {
+                PROFILE_SCOPE("integrate");
+                mov.updatePositions(cm);
+            }
+
+            //OOB objects are recorded and erased from the vector at playback
+            for (const auto & e : ent){
+                if (mov.outOfBounds(e)) commands[0].destroy(e);
+            }
+
+            {
+                PROFILE_SCOPE("deletion");
+                playbackCommands(commands, cm, ent);
+            }
+
+            arena.reset();
+        }
+
+        //draws all the dynamic entities
+        void render(entitySet & ent, componentManager & cm, sf::RenderWindow & w){
+            PROFILE_SCOPE("render");
+            for (auto & e : ent){
+                auto p = cm.getComponent<positionComponent>(e);
+                auto *s = cm.getComponent<rectangleSizeComponent>(e);
+                auto *c = cm.getComponent<colorComponent>(e);
 
-                //if object is deleted, dont draw
-                if (!mov.updatePosition(*it,v,p,cm,ent)) continue;                
-                
                 //draw circles and squares
                 if (!s){
-                    auto *s = cm.getComponent<circleSizeComponent>(*it);
+                    auto *s = cm.getComponent<circleSizeComponent>(e);
                     cir.renderCirc(s,p,c,w);
                 }else{
                     rec.renderRect(s,p,c,w);
                 }
-                it++;
             }
         }
+
+        //runs all dynamic systems
+        void runDynamicSystems(entitySet & ent, componentManager & cm, sf::RenderWindow & w){
+            PROFILE_SCOPE("dynamic");
+            runPhysicsSystems(ent, cm);
+            render(ent, cm, w);
+        }
 };